@@ -37,6 +37,25 @@ using std::vector;
 
 namespace env
 {
+  // counters of segment collision checks, filled by OccMap::isSegmentValid
+  struct SegmentCheckStats
+  {
+    SegmentCheckStats() : segments(0), rejected(0), checks(0), checks_until_rejection(0){};
+    long segments;
+    long rejected;
+    long checks;                 // occupancy lookups over all segments
+    long checks_until_rejection; // occupancy lookups spent on rejected segments
+    void reset() { *this = SegmentCheckStats(); }
+    void add(const SegmentCheckStats &other)
+    {
+      segments += other.segments;
+      rejected += other.rejected;
+      checks += other.checks;
+      checks_until_rejection += other.checks_until_rejection;
+    }
+    double expectedChecksUntilRejection() const { return rejected > 0 ? (double)checks_until_rejection / rejected : 0.0; }
+  };
+
   class OccMap
   {
   public:
@@ -53,9 +72,12 @@ namespace env
       Eigen::Vector3i idx = posToIndex(pos);
       if (!isInMap(idx))
         return false;
-      return (occupancy_buffer_[idxToAddress(idx)] == false);
+      return !isOccupied(idxToAddress(idx));
     };
-    bool isSegmentValid(const Eigen::Vector3d &p0, const Eigen::Vector3d &p1, double max_dist = DBL_MAX) const
+    // positions in SoA form, valid[i] = 1 if (xs[i], ys[i], zs[i]) is in map and free
+    void isStateValidBatch(const double *xs, const double *ys, const double *zs, int n, uint8_t *valid) const;
+    bool isSegmentValid(const Eigen::Vector3d &p0, const Eigen::Vector3d &p1, double max_dist = DBL_MAX,
+                        SegmentCheckStats *stats = nullptr) const
     {
       Eigen::Vector3d dp = p1 - p0;
       double dist = dp.norm();
@@ -63,6 +85,40 @@ namespace env
       {
         return false;
       }
+      bool valid;
+      int checks = 0;
+      if (use_bisection_check_)
+        valid = isSegmentValidBisection(p0, p1, checks);
+      else
+        valid = isSegmentValidSequential(p0, p1, checks);
+      if (stats)
+      {
+        stats->segments++;
+        stats->checks += checks;
+        if (!valid)
+        {
+          stats->rejected++;
+          stats->checks_until_rejection += checks;
+        }
+      }
+      return valid;
+    }
+
+    // free space index, empty until the global map is received
+    int freeVoxelNum() const { return free_prefix_.empty() ? 0 : free_prefix_.back(); }
+    // lower corner of the k-th free voxel, 0 <= k < freeVoxelNum()
+    Eigen::Vector3d freeVoxelCorner(int k) const;
+    // for every (x, y) column crossing the box, the [begin, end) ranks of its free voxels whose z
+    // lies in the box, the ranges of consecutive columns are merged when they touch
+    void freeVoxelRanges(const Eigen::Vector3d &box_min, const Eigen::Vector3d &box_max,
+                         std::vector<std::pair<int, int>> &ranges) const;
+
+    typedef shared_ptr<OccMap> Ptr;
+
+  private:
+    // walk the voxels from p0 toward p1 and stop at the first occupied one
+    bool isSegmentValidSequential(const Eigen::Vector3d &p0, const Eigen::Vector3d &p1, int &checks) const
+    {
       RayCaster raycaster;
       bool need_ray = raycaster.setInput(p0 / resolution_, p1 / resolution_); //(ray start, ray end)
       if (!need_ray)
@@ -74,6 +130,7 @@ namespace env
       while (raycaster.step(ray_pt))
       {
         Eigen::Vector3d tmp = (ray_pt + half) * resolution_;
+        checks++;
         if (!this->isStateValid(tmp))
         {
           return false;
@@ -82,10 +139,66 @@ namespace env
       return true;
     }
 
-    typedef shared_ptr<OccMap> Ptr;
+    // same voxels as isSegmentValidSequential, but the occupancy lookups are visited middle
+    // first, then the middles of the two halves, of the four quarters, ... down to single
+    // voxels, so an obstacle in the middle of a long edge is found early.
+    bool isSegmentValidBisection(const Eigen::Vector3d &p0, const Eigen::Vector3d &p1, int &checks) const
+    {
+      RayCaster raycaster;
+      bool need_ray = raycaster.setInput(p0 / resolution_, p1 / resolution_);
+      if (!need_ray)
+        return true;
+      Eigen::Vector3d half = Eigen::Vector3d(0.5, 0.5, 0.5);
+      Eigen::Vector3d ray_pt;
+      if (!raycaster.step(ray_pt)) // skip the ray start point
+        return true;
 
-  private:
-    std::vector<bool> occupancy_buffer_;
+      // the ray walk itself is pure arithmetic, only collect the addresses here
+      static thread_local std::vector<int> addrs;
+      addrs.clear();
+      while (raycaster.step(ray_pt))
+      {
+        Eigen::Vector3i idx = posToIndex((ray_pt + half) * resolution_);
+        if (!isInMap(idx))
+        {
+          checks++;
+          return false;
+        }
+        addrs.push_back(idxToAddress(idx));
+      }
+
+      // breadth first over the [lo, hi) spans, each one is split at its middle voxel, so every
+      // voxel is visited exactly once and the check stays exhaustive
+      static thread_local std::vector<std::pair<int, int>> spans;
+      spans.clear();
+      if (!addrs.empty())
+        spans.emplace_back(0, (int)addrs.size());
+      for (size_t head = 0; head < spans.size(); ++head)
+      {
+        int lo = spans[head].first, hi = spans[head].second;
+        int mid = lo + (hi - lo) / 2;
+        checks++;
+        if (isOccupied(addrs[mid]))
+          return false;
+        if (lo < mid)
+          spans.emplace_back(lo, mid);
+        if (mid + 1 < hi)
+          spans.emplace_back(mid + 1, hi);
+      }
+      return true;
+    }
+
+    bool use_bisection_check_;
+    // one bit per voxel, packed into 64-bit words
+    std::vector<uint64_t> occupancy_buffer_;
+    bool isOccupied(const int &address) const;
+    // number of occupied voxels in the addresses [begin, end), a popcount per 64 voxels
+    int occupiedNum(int begin, int end) const;
+
+    // free_prefix_[c] is the number of free voxels in the (x, y) columns before column c,
+    // columns are x major like the addresses, so a voxel rank maps back by a binary search
+    std::vector<int> free_prefix_;
+    void buildFreeIndex();
 
     // map property
     Eigen::Vector3i grid_size_; // map size in index
@@ -127,6 +240,11 @@ namespace env
     return id(0) * grid_size_y_multiply_z_ + id(1) * grid_size_(2) + id(2);
   }
 
+  inline bool OccMap::isOccupied(const int &address) const
+  {
+    return (occupancy_buffer_[address >> 6] >> (address & 63)) & 1ULL;
+  }
+
   inline bool OccMap::isInMap(const Eigen::Vector3d &pos) const
   {
     Eigen::Vector3i idx;
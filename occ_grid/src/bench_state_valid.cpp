@@ -0,0 +1,84 @@
+/*
+Copyright (C) 2022 Hongkai Ye (kyle_yeh@163.com)
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+// micro-benchmark of OccMap::isStateValidBatch against the scalar OccMap::isStateValid
+// on a 500x500x80 grid, run with: rosrun occ_grid bench_state_valid
+#include "occ_grid/occ_map.h"
+
+#include <ros/ros.h>
+#include <random>
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "bench_state_valid");
+  ros::NodeHandle nh("~");
+
+  int query_num, rounds;
+  nh.param("query_num", query_num, 1000000);
+  nh.param("rounds", rounds, 10);
+
+  // 50m x 50m x 8m at 0.1m resolution -> 500 x 500 x 80 voxels
+  nh.setParam("occ_map/origin_x", -25.0);
+  nh.setParam("occ_map/origin_y", -25.0);
+  nh.setParam("occ_map/origin_z", -1.0);
+  nh.setParam("occ_map/map_size_x", 50.0);
+  nh.setParam("occ_map/map_size_y", 50.0);
+  nh.setParam("occ_map/map_size_z", 8.0);
+  nh.setParam("occ_map/resolution", 0.1);
+  env::OccMap map;
+  map.init(nh);
+
+  // slightly larger than the map so that some queries are out of bound
+  std::mt19937_64 gen(0);
+  std::uniform_real_distribution<double> rand_x(-26.0, 26.0), rand_z(-2.0, 8.0);
+  vector<double> xs(query_num), ys(query_num), zs(query_num);
+  vector<Eigen::Vector3d> pts(query_num);
+  for (int i = 0; i < query_num; ++i)
+  {
+    xs[i] = rand_x(gen);
+    ys[i] = rand_x(gen);
+    zs[i] = rand_z(gen);
+    pts[i] = Eigen::Vector3d(xs[i], ys[i], zs[i]);
+  }
+
+  vector<uint8_t> scalar_res(query_num), batch_res(query_num);
+  double scalar_time = DBL_MAX, batch_time = DBL_MAX;
+  for (int r = 0; r < rounds; ++r)
+  {
+    ros::WallTime t0 = ros::WallTime::now();
+    for (int i = 0; i < query_num; ++i)
+      scalar_res[i] = map.isStateValid(pts[i]);
+    scalar_time = min(scalar_time, (ros::WallTime::now() - t0).toSec());
+
+    t0 = ros::WallTime::now();
+    map.isStateValidBatch(xs.data(), ys.data(), zs.data(), query_num, batch_res.data());
+    batch_time = min(batch_time, (ros::WallTime::now() - t0).toSec());
+  }
+
+  int mismatch = 0;
+  for (int i = 0; i < query_num; ++i)
+    mismatch += scalar_res[i] != batch_res[i];
+
+  ROS_INFO_STREAM("[bench] " << query_num << " queries, best of " << rounds << " rounds");
+  ROS_INFO_STREAM("[bench] scalar isStateValid:     " << scalar_time * 1e9 / query_num << " ns/query");
+  ROS_INFO_STREAM("[bench] batch isStateValidBatch: " << batch_time * 1e9 / query_num << " ns/query");
+  ROS_INFO_STREAM("[bench] speedup: " << scalar_time / batch_time << ", mismatches: " << mismatch);
+  return 0;
+}
@@ -27,6 +27,7 @@ OF SUCH DAMAGE.
 #include <tf2/LinearMath/Quaternion.h>
 #include <chrono>
 #include <random>
+#include <algorithm>
 
 namespace env
 {
@@ -38,7 +39,117 @@ namespace env
     if (!isInMap(id))
       return;
 
-    occupancy_buffer_[idxToAddress(id)] = true;
+    int address = idxToAddress(id);
+    occupancy_buffer_[address >> 6] |= 1ULL << (address & 63);
+  }
+
+  void OccMap::isStateValidBatch(const double *xs, const double *ys, const double *zs, int n, uint8_t *valid) const
+  {
+    const int kChunk = 64;
+    Eigen::Array<int, kChunk, 1> ix, iy, iz, inside, address;
+    for (int base = 0; base < n; base += kChunk)
+    {
+      int m = min(kChunk, n - base);
+      Eigen::Map<const Eigen::ArrayXd> px(xs + base, m), py(ys + base, m), pz(zs + base, m);
+
+      // index and address computation for the whole chunk, vectorised by Eigen
+      ix.head(m) = ((px - origin_(0)) * resolution_inv_).floor().cast<int>();
+      iy.head(m) = ((py - origin_(1)) * resolution_inv_).floor().cast<int>();
+      iz.head(m) = ((pz - origin_(2)) * resolution_inv_).floor().cast<int>();
+      // same trick as isInMap(), negative iff any coordinate is out of range
+      inside.head(m) = ix.head(m).min(grid_size_(0) - 1 - ix.head(m))
+                           .min(iy.head(m).min(grid_size_(1) - 1 - iy.head(m)))
+                           .min(iz.head(m).min(grid_size_(2) - 1 - iz.head(m)));
+      address.head(m) = ix.head(m) * grid_size_y_multiply_z_ + iy.head(m) * grid_size_(2) + iz.head(m);
+
+      // fetch all the occupancy words of the chunk before touching any of them
+      for (int i = 0; i < m; ++i)
+      {
+        if (inside(i) >= 0)
+          __builtin_prefetch(&occupancy_buffer_[address(i) >> 6]);
+      }
+      for (int i = 0; i < m; ++i)
+      {
+        valid[base + i] = inside(i) >= 0 && !isOccupied(address(i));
+      }
+    }
+  }
+
+  void OccMap::buildFreeIndex()
+  {
+    int columns = grid_size_(0) * grid_size_(1);
+    free_prefix_.resize(columns + 1);
+    free_prefix_[0] = 0;
+    for (int c = 0; c < columns; ++c)
+    {
+      int free_num = 0;
+      for (int z = 0; z < grid_size_(2); ++z)
+        free_num += !isOccupied(c * grid_size_(2) + z);
+      free_prefix_[c + 1] = free_prefix_[c] + free_num;
+    }
+  }
+
+  Eigen::Vector3d OccMap::freeVoxelCorner(int k) const
+  {
+    int c = std::upper_bound(free_prefix_.begin(), free_prefix_.end(), k) - free_prefix_.begin() - 1;
+    int rank = k - free_prefix_[c];
+    int z = 0;
+    for (; z < grid_size_(2); ++z)
+    {
+      if (!isOccupied(c * grid_size_(2) + z) && rank-- == 0)
+        break;
+    }
+    Eigen::Vector3d pos;
+    indexToPos(c / grid_size_(1), c % grid_size_(1), z, pos);
+    return pos - Eigen::Vector3d::Constant(0.5 * resolution_);
+  }
+
+  void OccMap::freeVoxelRanges(const Eigen::Vector3d &box_min, const Eigen::Vector3d &box_max,
+                               std::vector<std::pair<int, int>> &ranges) const
+  {
+    ranges.clear();
+    if (free_prefix_.empty())
+      return;
+    Eigen::Vector3i lo = posToIndex(box_min), hi = posToIndex(box_max);
+    for (int i = 0; i < 3; ++i)
+    {
+      lo(i) = max(lo(i), 0);
+      hi(i) = min(hi(i), grid_size_(i) - 1);
+    }
+    if (lo(1) > hi(1) || lo(2) > hi(2))
+      return;
+    // within a column the free voxels are ranked by z, so the rank of the first free voxel at or
+    // above z is the free voxels of the previous columns plus the ones below z
+    for (int x = lo(0); x <= hi(0); ++x)
+    {
+      for (int y = lo(1); y <= hi(1); ++y)
+      {
+        int c = x * grid_size_(1) + y;
+        int base = c * grid_size_(2);
+        int begin = free_prefix_[c] + lo(2) - occupiedNum(base, base + lo(2));
+        int end = free_prefix_[c] + hi(2) + 1 - occupiedNum(base, base + hi(2) + 1);
+        if (end <= begin)
+          continue;
+        if (!ranges.empty() && ranges.back().second == begin)
+          ranges.back().second = end;
+        else
+          ranges.emplace_back(begin, end);
+      }
+    }
+  }
+
+  int OccMap::occupiedNum(int begin, int end) const
+  {
+    int num = 0;
+    while (begin < end)
+    {
+      int bit = begin & 63;
+      int len = min(64 - bit, end - begin);
+      uint64_t mask = (len == 64 ? ~0ULL : (1ULL << len) - 1) << bit;
+      num += __builtin_popcountll(occupancy_buffer_[begin >> 6] & mask);
+      begin += len;
+    }
+    return num;
   }
 
   void OccMap::globalOccVisCallback(const ros::TimerEvent &e)
@@ -71,13 +182,14 @@ namespace env
       this->setOccupancy(p3d);
     }
     is_global_map_valid_ = true;
+    buildFreeIndex();
 
     glb_cloud_ptr_->points.clear();
     for (int x = 0; x < grid_size_[0]; ++x)
       for (int y = 0; y < grid_size_[1]; ++y)
         for (int z = 0; z < grid_size_[2]; ++z)
         {
-          if (occupancy_buffer_[idxToAddress(x, y, z)] == true)
+          if (isOccupied(idxToAddress(x, y, z)))
           {
             Eigen::Vector3d pos;
             indexToPos(x, y, z, pos);
@@ -104,6 +216,7 @@ namespace env
     node_.param("occ_map/map_size_y", map_size_(1), 40.0);
     node_.param("occ_map/map_size_z", map_size_(2), 5.0);
     node_.param("occ_map/resolution", resolution_, 0.2);
+    node_.param("occ_map/bisection_segment_check", use_bisection_check_, false);
     resolution_inv_ = 1 / resolution_;
 
     is_global_map_valid_ = false;
@@ -119,8 +232,8 @@ namespace env
     // initialize size of buffer
     grid_size_y_multiply_z_ = grid_size_(1) * grid_size_(2);
     int buffer_size = grid_size_(0) * grid_size_y_multiply_z_;
-    occupancy_buffer_.resize(buffer_size);
-    fill(occupancy_buffer_.begin(), occupancy_buffer_.end(), false);
+    occupancy_buffer_.resize((buffer_size + 63) / 64);
+    fill(occupancy_buffer_.begin(), occupancy_buffer_.end(), 0);
 
     //set x-y boundary occ
     for (double cx = min_range_[0] + resolution_ / 2; cx <= max_range_[0] - resolution_ / 2; cx += resolution_)
@@ -0,0 +1,72 @@
+/*
+Copyright (C) 2022 Hongkai Ye (kyle_yeh@163.com)
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+#ifndef BENCH_QUERIES_H
+#define BENCH_QUERIES_H
+
+#include "self_msgs_and_srvs/GlbObsRcv.h"
+#include "occ_grid/occ_map.h"
+
+#include <ros/ros.h>
+#include <Eigen/Eigen>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace path_plan
+{
+  // the setup shared by the benchmark nodes: the map from the /pub_glb_obs service and a fixed
+  // set of queries drawn from a seed
+
+  inline void waitForMap(ros::NodeHandle &nh, const env::OccMap::Ptr &map)
+  {
+    ros::ServiceClient rcv_glb_obs_client = nh.serviceClient<self_msgs_and_srvs::GlbObsRcv>("/pub_glb_obs");
+    while (ros::ok() && !map->mapValid())
+    {
+      self_msgs_and_srvs::GlbObsRcv srv;
+      rcv_glb_obs_client.call(srv);
+      ros::Duration(0.5).sleep();
+      ros::spinOnce();
+    }
+  }
+
+  // valid start and goal pairs at least half the map apart
+  inline std::vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> benchQueries(const env::OccMap::Ptr &map, int query_num, int seed)
+  {
+    std::mt19937_64 gen(seed);
+    Eigen::Vector3d origin = map->getOrigin(), size = map->getMapSize();
+    std::uniform_real_distribution<double> rand01(0.0, 1.0);
+    std::vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> queries;
+    while ((int)queries.size() < query_num && ros::ok())
+    {
+      Eigen::Vector3d s, g;
+      for (int k = 0; k < 3; ++k)
+      {
+        s[k] = origin[k] + rand01(gen) * size[k];
+        g[k] = origin[k] + rand01(gen) * size[k];
+      }
+      if (map->isStateValid(s) && map->isStateValid(g) && (g - s).head<2>().norm() > 0.5 * size[0])
+        queries.emplace_back(s, g);
+    }
+    return queries;
+  }
+} // namespace path_plan
+
+#endif
@@ -0,0 +1,409 @@
+/*
+Copyright (C) 2022 Hongkai Ye (kyle_yeh@163.com)
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+#ifndef BI_RRT_STAR_H
+#define BI_RRT_STAR_H
+
+#include "occ_grid/occ_map.h"
+#include "visualization/visualization.hpp"
+#include "sampler.h"
+#include "node.h"
+#include "kdtree.h"
+
+#include <ros/ros.h>
+#include <utility>
+#include <atomic>
+
+namespace path_plan
+{
+  // bidirectional RRT* in the RRT*-Connect style: a tree rooted at the start and one rooted at the
+  // goal take turns, the new node of one tree is the target the other tree greedily connects to.
+  // cost_from_start of a node is its cost from the root of its own tree.
+  class BiRRTStar
+  {
+  public:
+    BiRRTStar() : cancel_token_(nullptr)
+    {
+      kd_tree_[0] = kd_tree_[1] = nullptr;
+    };
+    BiRRTStar(const ros::NodeHandle &nh, const env::OccMap::Ptr &mapPtr) : nh_(nh), map_ptr_(mapPtr), cancel_token_(nullptr)
+    {
+      nh_.param("BiRRT_Star/steer_length", steer_length_, 0.0);
+      nh_.param("BiRRT_Star/search_radius", search_radius_, 0.0);
+      nh_.param("BiRRT_Star/search_time", search_time_, 0.0);
+      nh_.param("BiRRT_Star/max_tree_node_nums", max_tree_node_nums_, 0);
+      nh_.param("BiRRT_Star/use_informed_sampling", use_informed_sampling_, true);
+
+      ROS_WARN_STREAM("[BiRRT*] param: steer_length: " << steer_length_);
+      ROS_WARN_STREAM("[BiRRT*] param: search_radius: " << search_radius_);
+      ROS_WARN_STREAM("[BiRRT*] param: search_time: " << search_time_);
+      ROS_WARN_STREAM("[BiRRT*] param: max_tree_node_nums: " << max_tree_node_nums_);
+      ROS_WARN_STREAM("[BiRRT*] param: use_informed_sampling: " << use_informed_sampling_);
+
+      sampler_.setSamplingRange(mapPtr->getOrigin(), mapPtr->getMapSize());
+
+      // both trees together hold at most max_tree_node_nums_ nodes
+      for (int t = 0; t < 2; ++t)
+      {
+        tree_[t].resize(max_tree_node_nums_);
+        node_nums_[t] = 0;
+        kd_tree_[t] = kd_create(3);
+      }
+      descendant_stack_.reserve(max_tree_node_nums_);
+    }
+    ~BiRRTStar()
+    {
+      for (int t = 0; t < 2; ++t)
+      {
+        if (kd_tree_[t])
+          kd_free(kd_tree_[t]);
+      }
+    };
+
+    bool plan(const Eigen::Vector3d &s, const Eigen::Vector3d &g)
+    {
+      reset();
+      if (!map_ptr_->isStateValid(s))
+      {
+        ROS_ERROR("[BiRRT*]: Start pos collide or out of bound");
+        return false;
+      }
+      if (!map_ptr_->isStateValid(g))
+      {
+        ROS_ERROR("[BiRRT*]: Goal pos collide or out of bound");
+        return false;
+      }
+
+      /* the roots of the two trees */
+      const Eigen::Vector3d roots[2] = {s, g};
+      for (int t = 0; t < 2; ++t)
+      {
+        tree_[t].x[0] = roots[t];
+        tree_[t].cost_from_start[0] = 0.0;
+        node_nums_[t] = 1;
+        kd_insert3(kd_tree_[t], roots[t][0], roots[t][1], roots[t][2], nodeIdToKdData(0));
+      }
+
+      ROS_INFO("[BiRRT*]: BiRRT starts planning a path");
+
+      sampler_.reset();
+      if (use_informed_sampling_)
+      {
+        calInformedSet(10000000000.0, s, g, scale_, trans_, rot_);
+        sampler_.setInformedTransRot(trans_, rot_);
+      }
+      return bi_rrt_star(s, g);
+    }
+
+    vector<Eigen::Vector3d> getPath()
+    {
+      return final_path_;
+    }
+
+    vector<vector<Eigen::Vector3d>> getAllPaths()
+    {
+      return path_list_;
+    }
+
+    vector<std::pair<double, double>> getSolutions()
+    {
+      return solution_cost_time_pair_list_;
+    }
+
+    vector<int> getSolutionIterations()
+    {
+      return solution_iteration_list_;
+    }
+
+    // see RRTStar::setCancelToken
+    void setCancelToken(const std::atomic<bool> *cancel_token)
+    {
+      cancel_token_ = cancel_token;
+    }
+
+    void setVisualizer(const std::shared_ptr<visualization::Visualization> &visPtr)
+    {
+      vis_ptr_ = visPtr;
+    };
+
+  private:
+    ros::NodeHandle nh_;
+    BiasSampler sampler_;
+
+    // for informed sampling
+    Eigen::Vector3d trans_, scale_;
+    Eigen::Matrix3d rot_;
+    bool use_informed_sampling_;
+
+    double steer_length_;
+    double search_radius_;
+    double search_time_;
+    int max_tree_node_nums_;
+
+    // tree 0 grows from the start, tree 1 from the goal, the root of both is node 0
+    RRTTree tree_[2];
+    kdtree *kd_tree_[2];
+    int node_nums_[2];
+    std::vector<NodeId> descendant_stack_;
+
+    // the best connection found so far, conn_[t] is its node in tree t
+    NodeId conn_[2];
+    double best_cost_;
+
+    double first_path_use_time_;
+    double final_path_use_time_;
+
+    vector<Eigen::Vector3d> final_path_;
+    vector<vector<Eigen::Vector3d>> path_list_;
+    vector<std::pair<double, double>> solution_cost_time_pair_list_;
+    vector<int> solution_iteration_list_;
+
+    // environment
+    env::OccMap::Ptr map_ptr_;
+    env::SegmentCheckStats seg_check_stats_;
+    std::shared_ptr<visualization::Visualization> vis_ptr_;
+    const std::atomic<bool> *cancel_token_;
+
+    void reset()
+    {
+      for (int t = 0; t < 2; ++t)
+      {
+        for (int i = 0; i < node_nums_[t]; ++i)
+          tree_[t].clearNode(i);
+        node_nums_[t] = 0;
+        kd_clear(kd_tree_[t]);
+      }
+      conn_[0] = conn_[1] = NULL_NODE;
+      best_cost_ = DBL_MAX;
+      final_path_.clear();
+      path_list_.clear();
+      solution_cost_time_pair_list_.clear();
+      solution_iteration_list_.clear();
+      seg_check_stats_.reset();
+    }
+
+    // the ray cast is not symmetric, so an edge is checked in the direction the final path runs
+    // through it: away from the root in the start tree, toward the root in the goal tree
+    bool isEdgeValid(int t, const Eigen::Vector3d &parent, const Eigen::Vector3d &child)
+    {
+      if (t == 0)
+        return map_ptr_->isSegmentValid(parent, child, DBL_MAX, &seg_check_stats_);
+      return map_ptr_->isSegmentValid(child, parent, DBL_MAX, &seg_check_stats_);
+    }
+
+    // one RRT* step of tree t toward target: steer from the nearest node, choose the parent in the
+    // search radius and rewire the neighbours. NULL_NODE if the steered segment collides
+    NodeId extend(int t, const Eigen::Vector3d &target, bool &reached)
+    {
+      RRTTree &tree = tree_[t];
+      const Eigen::Vector3d &other_root = tree_[1 - t].x[0];
+      reached = false;
+
+      struct kdres *p_nearest = kd_nearest3(kd_tree_[t], target[0], target[1], target[2]);
+      if (p_nearest == nullptr)
+      {
+        ROS_ERROR("nearest query error");
+        return NULL_NODE;
+      }
+      NodeId nearest_node = kdDataToNodeId(kd_res_item_data(p_nearest));
+      kd_res_free(p_nearest);
+
+      Eigen::Vector3d x_new = steer(tree.x[nearest_node], target, steer_length_);
+      if (!isEdgeValid(t, tree.x[nearest_node], x_new))
+        return NULL_NODE;
+
+      vector<NodeId> neighbour_nodes;
+      struct kdres *nbr_set = kd_nearest_range3(kd_tree_[t], x_new[0], x_new[1], x_new[2], search_radius_);
+      if (nbr_set == nullptr)
+      {
+        ROS_ERROR("bkwd kd range query error");
+        return NULL_NODE;
+      }
+      while (!kd_res_end(nbr_set))
+      {
+        neighbour_nodes.emplace_back(kdDataToNodeId(kd_res_item_data(nbr_set)));
+        kd_res_next(nbr_set);
+      }
+      kd_res_free(nbr_set);
+
+      /* choose parent */
+      double cost_from_p = calDist(tree.x[nearest_node], x_new);
+      double min_dist_from_start = tree.cost_from_start[nearest_node] + cost_from_p;
+      NodeId min_node = nearest_node;
+      for (const NodeId &curr_node : neighbour_nodes)
+      {
+        double dist2current = calDist(tree.x[curr_node], x_new);
+        double current_dist_from_start = tree.cost_from_start[curr_node] + dist2current;
+        if (current_dist_from_start < min_dist_from_start &&
+            isEdgeValid(t, tree.x[curr_node], x_new))
+        {
+          min_node = curr_node;
+          cost_from_p = dist2current;
+          min_dist_from_start = current_dist_from_start;
+        }
+      }
+
+      NodeId new_node = node_nums_[t]++;
+      tree.link(new_node, min_node);
+      tree.x[new_node] = x_new;
+      tree.cost_from_start[new_node] = min_dist_from_start;
+      tree.cost_from_parent[new_node] = cost_from_p;
+      kd_insert3(kd_tree_[t], x_new[0], x_new[1], x_new[2], nodeIdToKdData(new_node));
+
+      /* rewire, only where the path through the node can still beat the best solution */
+      for (const NodeId &curr_node : neighbour_nodes)
+      {
+        double dist_to_child = calDist(x_new, tree.x[curr_node]);
+        double current_dist_from_new = min_dist_from_start + dist_to_child;
+        if (current_dist_from_new < tree.cost_from_start[curr_node] &&
+            current_dist_from_new + calDist(tree.x[curr_node], other_root) < best_cost_ &&
+            isEdgeValid(t, x_new, tree.x[curr_node]))
+        {
+          changeNodeParent(tree, curr_node, new_node, dist_to_child, descendant_stack_);
+        }
+      }
+
+      reached = x_new == target;
+      return new_node;
+    }
+
+    double connectionCost(NodeId n0, NodeId n1)
+    {
+      return tree_[0].cost_from_start[n0] + tree_[1].cost_from_start[n1] + calDist(tree_[0].x[n0], tree_[1].x[n1]);
+    }
+
+    // start tree from its root to conn_[0], then the goal tree from conn_[1] to its root
+    void fillPath(vector<Eigen::Vector3d> &path)
+    {
+      path.clear();
+      for (NodeId node = conn_[0]; node != NULL_NODE; node = tree_[0].parent[node])
+        path.push_back(tree_[0].x[node]);
+      std::reverse(std::begin(path), std::end(path));
+      for (NodeId node = conn_[1]; node != NULL_NODE; node = tree_[1].parent[node])
+      {
+        // the connected nodes of a greedy connect are at the same position
+        if (tree_[1].x[node] != path.back())
+          path.push_back(tree_[1].x[node]);
+      }
+    }
+
+    void storeSolution(const ros::Time &start_time, double c_square, int iteration)
+    {
+      best_cost_ = connectionCost(conn_[0], conn_[1]);
+      vector<Eigen::Vector3d> curr_best_path;
+      fillPath(curr_best_path);
+      path_list_.emplace_back(curr_best_path);
+      solution_cost_time_pair_list_.emplace_back(best_cost_, (ros::Time::now() - start_time).toSec());
+      solution_iteration_list_.push_back(iteration);
+
+      if (use_informed_sampling_)
+      {
+        scale_[0] = best_cost_ / 2.0;
+        scale_[1] = sqrt(scale_[0] * scale_[0] - c_square);
+        scale_[2] = scale_[1];
+        sampler_.setInformedSacling(scale_);
+      }
+    }
+
+    bool cancelled() const
+    {
+      return cancel_token_ && cancel_token_->load(std::memory_order_relaxed);
+    }
+
+    bool bi_rrt_star(const Eigen::Vector3d &s, const Eigen::Vector3d &g)
+    {
+      ros::Time rrt_start_time = ros::Time::now();
+      bool goal_found = false;
+      double c_square = (g - s).squaredNorm() / 4.0;
+
+      int a = 0; // the tree extended toward the sample in this iteration
+      for (int idx = 0; (ros::Time::now() - rrt_start_time).toSec() < search_time_ && node_nums_[0] + node_nums_[1] < max_tree_node_nums_ && !cancelled(); ++idx, a = 1 - a)
+      {
+        Eigen::Vector3d x_rand;
+        sampler_.samplingOnce(x_rand);
+        if (goal_found && calDist(s, x_rand) + calDist(x_rand, g) >= best_cost_)
+          continue;
+        if (!map_ptr_->isStateValid(x_rand))
+          continue;
+
+        bool reached;
+        NodeId new_a = extend(a, x_rand, reached);
+        if (new_a == NULL_NODE)
+          continue;
+
+        /* connect: the other tree extends toward the new node until it reaches it or is blocked */
+        int b = 1 - a;
+        NodeId new_b = NULL_NODE;
+        reached = false;
+        while (!reached && node_nums_[0] + node_nums_[1] < max_tree_node_nums_)
+        {
+          new_b = extend(b, tree_[a].x[new_a], reached);
+          if (new_b == NULL_NODE)
+            break;
+        }
+
+        NodeId n[2];
+        n[a] = new_a;
+        n[b] = new_b;
+        bool improved = false;
+        if (reached && connectionCost(n[0], n[1]) < best_cost_)
+        {
+          conn_[0] = n[0];
+          conn_[1] = n[1];
+          improved = true;
+        }
+        // rewiring may also have shortened the best connection
+        else if (goal_found && connectionCost(conn_[0], conn_[1]) < best_cost_ - 1e-9)
+        {
+          improved = true;
+        }
+        if (improved)
+        {
+          if (!goal_found)
+            first_path_use_time_ = (ros::Time::now() - rrt_start_time).toSec();
+          goal_found = true;
+          storeSolution(rrt_start_time, c_square, idx);
+        }
+      }
+
+      vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> edges;
+      for (int t = 0; t < 2; ++t)
+        for (int i = 1; i < node_nums_[t]; ++i)
+          edges.emplace_back(tree_[t].x[tree_[t].parent[i]], tree_[t].x[i]);
+      vis_ptr_->visualize_pairline(edges, "tree_edges", visualization::Color::red, 0.04);
+
+      ROS_INFO_STREAM("[BiRRT*]: nodes: " << node_nums_[0] << " + " << node_nums_[1] << ", segment checks: "
+                      << seg_check_stats_.segments << ", rejected: " << seg_check_stats_.rejected);
+      if (goal_found)
+      {
+        final_path_use_time_ = (ros::Time::now() - rrt_start_time).toSec();
+        fillPath(final_path_);
+        ROS_INFO_STREAM("[BiRRT*]: first path length: " << solution_cost_time_pair_list_.front().first << ", use_time: " << first_path_use_time_);
+      }
+      else
+      {
+        ROS_ERROR_STREAM("[BiRRT*]: NOT CONNECTED TO GOAL after " << (ros::Time::now() - rrt_start_time).toSec() << " seconds");
+      }
+      return goal_found;
+    }
+  };
+} // namespace path_plan
+
+#endif
@@ -0,0 +1,454 @@
+/*
+Copyright (C) 2022 Hongkai Ye (kyle_yeh@163.com)
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+#ifndef BIT_STAR_H
+#define BIT_STAR_H
+
+#include "occ_grid/occ_map.h"
+#include "visualization/visualization.hpp"
+#include "sampler.h"
+#include "node.h"
+#include "kdtree.h"
+
+#include <ros/ros.h>
+#include <utility>
+#include <atomic>
+#include <queue>
+
+namespace path_plan
+{
+  // Batch Informed Trees: batches of informed samples form an implicit random geometric graph,
+  // the tree is grown by processing its edges in order of their estimated solution cost, and an
+  // edge is only collision checked when it is popped and can still improve the solution
+  class BITStar
+  {
+  public:
+    BITStar() : samples_kd_tree_(nullptr), vertices_kd_tree_(nullptr), cancel_token_(nullptr){};
+    BITStar(const ros::NodeHandle &nh, const env::OccMap::Ptr &mapPtr) : nh_(nh), map_ptr_(mapPtr), cancel_token_(nullptr)
+    {
+      nh_.param("BIT_Star/search_time", search_time_, 0.0);
+      nh_.param("BIT_Star/max_tree_node_nums", max_tree_node_nums_, 0);
+      nh_.param("BIT_Star/batch_size", batch_size_, 200);
+      nh_.param("BIT_Star/rewire_factor", rewire_factor_, 1.1);
+      nh_.param("BIT_Star/use_informed_sampling", use_informed_sampling_, true);
+
+      ROS_WARN_STREAM("[BIT*] param: search_time: " << search_time_);
+      ROS_WARN_STREAM("[BIT*] param: max_tree_node_nums: " << max_tree_node_nums_);
+      ROS_WARN_STREAM("[BIT*] param: batch_size: " << batch_size_);
+      ROS_WARN_STREAM("[BIT*] param: rewire_factor: " << rewire_factor_);
+      ROS_WARN_STREAM("[BIT*] param: use_informed_sampling: " << use_informed_sampling_);
+
+      sampler_.setSamplingRange(mapPtr->getOrigin(), mapPtr->getMapSize());
+      map_volume_ = mapPtr->getMapSize().prod();
+
+      tree_.resize(max_tree_node_nums_);
+      is_new_.assign(max_tree_node_nums_, 0);
+      node_nums_ = 0;
+      descendant_stack_.reserve(max_tree_node_nums_);
+      samples_kd_tree_ = kd_create(3);
+      vertices_kd_tree_ = kd_create(3);
+    }
+    ~BITStar()
+    {
+      if (samples_kd_tree_)
+        kd_free(samples_kd_tree_);
+      if (vertices_kd_tree_)
+        kd_free(vertices_kd_tree_);
+    };
+
+    bool plan(const Eigen::Vector3d &s, const Eigen::Vector3d &g)
+    {
+      reset();
+      if (!map_ptr_->isStateValid(s))
+      {
+        ROS_ERROR("[BIT*]: Start pos collide or out of bound");
+        return false;
+      }
+      if (!map_ptr_->isStateValid(g))
+      {
+        ROS_ERROR("[BIT*]: Goal pos collide or out of bound");
+        return false;
+      }
+
+      start_ = s;
+      goal_ = g;
+      start_node_ = addVertex(NULL_NODE, s, 0.0, 0.0);
+      // the goal is the first sample, it becomes a vertex once it is connected
+      samples_.push_back(g);
+      sample_node_.push_back(NULL_NODE);
+
+      ROS_INFO("[BIT*]: BIT* starts planning a path");
+
+      sampler_.reset();
+      if (use_informed_sampling_)
+      {
+        calInformedSet(10000000000.0, s, g, scale_, trans_, rot_);
+        sampler_.setInformedTransRot(trans_, rot_);
+      }
+      return bit_star();
+    }
+
+    vector<Eigen::Vector3d> getPath()
+    {
+      return final_path_;
+    }
+
+    vector<vector<Eigen::Vector3d>> getAllPaths()
+    {
+      return path_list_;
+    }
+
+    vector<std::pair<double, double>> getSolutions()
+    {
+      return solution_cost_time_pair_list_;
+    }
+
+    vector<int> getSolutionIterations()
+    {
+      return solution_iteration_list_;
+    }
+
+    // see RRTStar::setCancelToken
+    void setCancelToken(const std::atomic<bool> *cancel_token)
+    {
+      cancel_token_ = cancel_token;
+    }
+
+    void setVisualizer(const std::shared_ptr<visualization::Visualization> &visPtr)
+    {
+      vis_ptr_ = visPtr;
+    };
+
+  private:
+    // a queued edge from the vertex v to a sample (target_is_vertex false) or to a vertex
+    struct QueueEdge
+    {
+      double key; // g_T(v) + c_hat(v, x) + h_hat(x) when queued
+      NodeId v;
+      int target;
+      bool target_is_vertex;
+      bool operator>(const QueueEdge &other) const { return key > other.key; }
+    };
+    typedef std::pair<double, NodeId> QueueVertex; // g_T(v) + h_hat(v), v
+
+    ros::NodeHandle nh_;
+    BiasSampler sampler_;
+
+    // for informed sampling
+    Eigen::Vector3d trans_, scale_;
+    Eigen::Matrix3d rot_;
+    bool use_informed_sampling_;
+
+    double search_time_;
+    int max_tree_node_nums_;
+    int batch_size_;
+    double rewire_factor_;
+    double map_volume_;
+    double radius_;
+
+    Eigen::Vector3d start_, goal_;
+    RRTTree tree_;
+    int node_nums_;
+    NodeId start_node_;
+    NodeId goal_node_;
+    double best_cost_;
+    std::vector<uint8_t> is_new_; // added in the current batch, its edges to other vertices are queued too
+    std::vector<NodeId> descendant_stack_;
+
+    // samples of all batches, sample_node_ is the vertex of a connected sample
+    std::vector<Eigen::Vector3d> samples_;
+    std::vector<NodeId> sample_node_;
+    kdtree *samples_kd_tree_;  // the unconnected samples of the current batch
+    kdtree *vertices_kd_tree_;
+
+    std::priority_queue<QueueVertex, std::vector<QueueVertex>, std::greater<QueueVertex>> vertex_queue_;
+    std::priority_queue<QueueEdge, std::vector<QueueEdge>, std::greater<QueueEdge>> edge_queue_;
+
+    int batch_nums_;
+    int processed_edge_nums_; // the iterations of BIT*, reported by getSolutionIterations()
+
+    double first_path_use_time_;
+    double final_path_use_time_;
+
+    vector<Eigen::Vector3d> final_path_;
+    vector<vector<Eigen::Vector3d>> path_list_;
+    vector<std::pair<double, double>> solution_cost_time_pair_list_;
+    vector<int> solution_iteration_list_;
+
+    // environment
+    env::OccMap::Ptr map_ptr_;
+    env::SegmentCheckStats seg_check_stats_;
+    std::shared_ptr<visualization::Visualization> vis_ptr_;
+    const std::atomic<bool> *cancel_token_;
+
+    void reset()
+    {
+      for (int i = 0; i < node_nums_; ++i)
+      {
+        tree_.clearNode(i);
+        is_new_[i] = 0;
+      }
+      node_nums_ = 0;
+      goal_node_ = NULL_NODE;
+      best_cost_ = DBL_MAX;
+      samples_.clear();
+      sample_node_.clear();
+      kd_clear(samples_kd_tree_);
+      kd_clear(vertices_kd_tree_);
+      vertex_queue_ = decltype(vertex_queue_)();
+      edge_queue_ = decltype(edge_queue_)();
+      batch_nums_ = 0;
+      processed_edge_nums_ = 0;
+      final_path_.clear();
+      path_list_.clear();
+      solution_cost_time_pair_list_.clear();
+      solution_iteration_list_.clear();
+      seg_check_stats_.reset();
+    }
+
+    // admissible estimates of the cost from the start and to the goal
+    double gHat(const Eigen::Vector3d &x) { return calDist(start_, x); }
+    double hHat(const Eigen::Vector3d &x) { return calDist(x, goal_); }
+
+    NodeId addVertex(NodeId parent, const Eigen::Vector3d &x, double cost_from_start, double cost_from_parent)
+    {
+      NodeId n = node_nums_++;
+      if (parent != NULL_NODE)
+        tree_.link(n, parent);
+      tree_.x[n] = x;
+      tree_.cost_from_start[n] = cost_from_start;
+      tree_.cost_from_parent[n] = cost_from_parent;
+      is_new_[n] = 1;
+      kd_insert3(vertices_kd_tree_, x[0], x[1], x[2], nodeIdToKdData(n));
+      vertex_queue_.emplace(cost_from_start + hHat(x), n);
+      return n;
+    }
+
+    // drop the samples that can not improve the solution, add a new informed batch and requeue the tree
+    void newBatch()
+    {
+      batch_nums_++;
+      std::vector<Eigen::Vector3d> kept;
+      for (size_t i = 0; i < samples_.size(); ++i)
+      {
+        if (sample_node_[i] == NULL_NODE && gHat(samples_[i]) + hHat(samples_[i]) < best_cost_)
+          kept.push_back(samples_[i]);
+      }
+      samples_.swap(kept);
+
+      const int max_tries = 100 * batch_size_;
+      Eigen::Vector3d x;
+      for (int i = 0, tries = 0; i < batch_size_ && tries < max_tries; ++tries)
+      {
+        sampler_.samplingOnce(x);
+        if (map_ptr_->isStateValid(x))
+        {
+          samples_.push_back(x);
+          i++;
+        }
+      }
+      sample_node_.assign(samples_.size(), NULL_NODE);
+
+      kd_clear(samples_kd_tree_);
+      for (size_t i = 0; i < samples_.size(); ++i)
+        kd_insert3(samples_kd_tree_, samples_[i][0], samples_[i][1], samples_[i][2], nodeIdToKdData(i));
+
+      // radius of the random geometric graph over the informed measure
+      int q = node_nums_ + samples_.size();
+      double measure = map_volume_;
+      if (best_cost_ < DBL_MAX)
+        measure = std::min(measure, 4.0 / 3.0 * M_PI * scale_.prod());
+      double gamma = 2.0 * pow(1.0 + 1.0 / 3.0, 1.0 / 3.0) * pow(measure / (4.0 / 3.0 * M_PI), 1.0 / 3.0);
+      radius_ = rewire_factor_ * gamma * pow(log((double)q) / q, 1.0 / 3.0);
+
+      vertex_queue_ = decltype(vertex_queue_)();
+      edge_queue_ = decltype(edge_queue_)();
+      for (int n = 0; n < node_nums_; ++n)
+      {
+        if (tree_.cost_from_start[n] + hHat(tree_.x[n]) < best_cost_)
+          vertex_queue_.emplace(tree_.cost_from_start[n] + hHat(tree_.x[n]), (NodeId)n);
+      }
+    }
+
+    // queue the edges from v to the nearby samples, and for a new vertex to the nearby vertices
+    void expandVertex(NodeId v)
+    {
+      const Eigen::Vector3d &xv = tree_.x[v];
+      double g_v = tree_.cost_from_start[v];
+      if (g_v + hHat(xv) >= best_cost_)
+        return;
+
+      struct kdres *nbr_set = kd_nearest_range3(samples_kd_tree_, xv[0], xv[1], xv[2], radius_);
+      while (nbr_set && !kd_res_end(nbr_set))
+      {
+        int x = kdDataToNodeId(kd_res_item_data(nbr_set));
+        kd_res_next(nbr_set);
+        if (sample_node_[x] != NULL_NODE)
+          continue;
+        double c_hat = calDist(xv, samples_[x]);
+        if (gHat(xv) + c_hat + hHat(samples_[x]) < best_cost_)
+          edge_queue_.push(QueueEdge{g_v + c_hat + hHat(samples_[x]), v, x, false});
+      }
+      if (nbr_set)
+        kd_res_free(nbr_set);
+
+      if (!is_new_[v])
+        return;
+      is_new_[v] = 0;
+      nbr_set = kd_nearest_range3(vertices_kd_tree_, xv[0], xv[1], xv[2], radius_);
+      while (nbr_set && !kd_res_end(nbr_set))
+      {
+        NodeId w = kdDataToNodeId(kd_res_item_data(nbr_set));
+        kd_res_next(nbr_set);
+        if (w == v || tree_.parent[v] == w || tree_.parent[w] == v)
+          continue;
+        double c_hat = calDist(xv, tree_.x[w]);
+        if (gHat(xv) + c_hat + hHat(tree_.x[w]) < best_cost_ && g_v + c_hat < tree_.cost_from_start[w])
+          edge_queue_.push(QueueEdge{g_v + c_hat + hHat(tree_.x[w]), v, (int)w, true});
+      }
+      if (nbr_set)
+        kd_res_free(nbr_set);
+    }
+
+    void fillPath(NodeId n, vector<Eigen::Vector3d> &path)
+    {
+      path.clear();
+      for (NodeId node = n; node != NULL_NODE; node = tree_.parent[node])
+        path.push_back(tree_.x[node]);
+      std::reverse(std::begin(path), std::end(path));
+    }
+
+    void storeSolution(const ros::Time &start_time)
+    {
+      best_cost_ = tree_.cost_from_start[goal_node_];
+      vector<Eigen::Vector3d> curr_best_path;
+      fillPath(goal_node_, curr_best_path);
+      path_list_.emplace_back(curr_best_path);
+      solution_cost_time_pair_list_.emplace_back(best_cost_, (ros::Time::now() - start_time).toSec());
+      solution_iteration_list_.push_back(processed_edge_nums_);
+
+      if (use_informed_sampling_)
+      {
+        double c_square = (goal_ - start_).squaredNorm() / 4.0;
+        scale_[0] = best_cost_ / 2.0;
+        scale_[1] = sqrt(scale_[0] * scale_[0] - c_square);
+        scale_[2] = scale_[1];
+        sampler_.setInformedSacling(scale_);
+      }
+    }
+
+    bool cancelled() const
+    {
+      return cancel_token_ && cancel_token_->load(std::memory_order_relaxed);
+    }
+
+    bool bit_star()
+    {
+      ros::Time bit_start_time = ros::Time::now();
+      bool goal_found = false;
+      newBatch();
+
+      while ((ros::Time::now() - bit_start_time).toSec() < search_time_ && node_nums_ < max_tree_node_nums_ && !cancelled())
+      {
+        if (edge_queue_.empty() && vertex_queue_.empty())
+          newBatch();
+
+        // expand vertices while the best of them may lead to a better edge than the best queued one
+        while (!vertex_queue_.empty() && (edge_queue_.empty() || vertex_queue_.top().first <= edge_queue_.top().key))
+        {
+          NodeId v = vertex_queue_.top().second;
+          vertex_queue_.pop();
+          expandVertex(v);
+        }
+        if (edge_queue_.empty())
+          continue;
+
+        QueueEdge e = edge_queue_.top();
+        edge_queue_.pop();
+        if (e.key >= best_cost_)
+        {
+          // nothing left in this batch can improve the solution
+          edge_queue_ = decltype(edge_queue_)();
+          vertex_queue_ = decltype(vertex_queue_)();
+          continue;
+        }
+        processed_edge_nums_++;
+
+        NodeId v = e.v;
+        NodeId w = e.target_is_vertex ? (NodeId)e.target : sample_node_[e.target];
+        const Eigen::Vector3d &xv = tree_.x[v];
+        const Eigen::Vector3d &xt = e.target_is_vertex ? tree_.x[w] : samples_[e.target];
+        double g_v = tree_.cost_from_start[v];
+        double c_hat = calDist(xv, xt);
+        double g_t = w == NULL_NODE ? DBL_MAX : tree_.cost_from_start[w];
+
+        // the estimates with the current cost of v, before paying for the collision check
+        if (g_v + c_hat + hHat(xt) >= best_cost_ || g_v + c_hat >= g_t)
+          continue;
+        if (!map_ptr_->isSegmentValid(xv, xt, DBL_MAX, &seg_check_stats_))
+          continue;
+
+        if (w != NULL_NODE)
+        {
+          changeNodeParent(tree_, w, v, c_hat, descendant_stack_);
+        }
+        else
+        {
+          w = addVertex(v, xt, g_v + c_hat, c_hat);
+          sample_node_[e.target] = w;
+          if (xt == goal_)
+            goal_node_ = w;
+        }
+
+        if (goal_node_ != NULL_NODE && tree_.cost_from_start[goal_node_] < best_cost_)
+        {
+          if (!goal_found)
+            first_path_use_time_ = (ros::Time::now() - bit_start_time).toSec();
+          goal_found = true;
+          storeSolution(bit_start_time);
+        }
+      }
+
+      vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> edges;
+      for (int i = 0; i < node_nums_; ++i)
+      {
+        if (tree_.parent[i] != NULL_NODE)
+          edges.emplace_back(tree_.x[tree_.parent[i]], tree_.x[i]);
+      }
+      vis_ptr_->visualize_pairline(edges, "tree_edges", visualization::Color::red, 0.04);
+
+      ROS_INFO_STREAM("[BIT*]: batches: " << batch_nums_ << ", vertices: " << node_nums_ << ", samples: " << samples_.size()
+                      << ", processed edges: " << processed_edge_nums_ << ", segment checks: " << seg_check_stats_.segments);
+      if (goal_found)
+      {
+        final_path_use_time_ = (ros::Time::now() - bit_start_time).toSec();
+        fillPath(goal_node_, final_path_);
+        ROS_INFO_STREAM("[BIT*]: first path length: " << solution_cost_time_pair_list_.front().first << ", use_time: " << first_path_use_time_);
+      }
+      else
+      {
+        ROS_ERROR_STREAM("[BIT*]: NOT CONNECTED TO GOAL after " << (ros::Time::now() - bit_start_time).toSec() << " seconds");
+      }
+      return goal_found;
+    }
+  };
+} // namespace path_plan
+
+#endif
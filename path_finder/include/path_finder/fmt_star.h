@@ -0,0 +1,329 @@
+/*
+Copyright (C) 2022 Hongkai Ye (kyle_yeh@163.com)
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+#ifndef FMT_STAR_H
+#define FMT_STAR_H
+
+#include "occ_grid/occ_map.h"
+#include "visualization/visualization.hpp"
+#include "sampler.h"
+#include "node.h"
+#include "kdtree.h"
+
+#include <ros/ros.h>
+#include <utility>
+#include <atomic>
+#include <queue>
+
+namespace path_plan
+{
+  // Fast Marching Tree for single-shot queries: sample_num free states are drawn and validated
+  // in bulk up front, then a wavefront marches from the start in cost order. Every unvisited
+  // neighbour of the front node is connected to its locally best open neighbour, and only that
+  // one edge is collision checked.
+  class FMTStar
+  {
+  public:
+    FMTStar() : kd_tree_(nullptr), cancel_token_(nullptr){};
+    FMTStar(const ros::NodeHandle &nh, const env::OccMap::Ptr &mapPtr) : nh_(nh), map_ptr_(mapPtr), cancel_token_(nullptr)
+    {
+      nh_.param("FMT_Star/sample_num", sample_num_, 5000);
+      nh_.param("FMT_Star/rewire_factor", rewire_factor_, 1.1);
+
+      ROS_WARN_STREAM("[FMT*] param: sample_num: " << sample_num_);
+      ROS_WARN_STREAM("[FMT*] param: rewire_factor: " << rewire_factor_);
+
+      sampler_.setSamplingRange(mapPtr->getOrigin(), mapPtr->getMapSize());
+      map_volume_ = mapPtr->getMapSize().prod();
+
+      // the samples plus start and goal
+      tree_.resize(sample_num_ + 2);
+      node_nums_ = 0;
+      kd_tree_ = kd_create(3);
+    }
+    ~FMTStar()
+    {
+      if (kd_tree_)
+        kd_free(kd_tree_);
+    };
+
+    bool plan(const Eigen::Vector3d &s, const Eigen::Vector3d &g)
+    {
+      reset();
+      if (!map_ptr_->isStateValid(s))
+      {
+        ROS_ERROR("[FMT*]: Start pos collide or out of bound");
+        return false;
+      }
+      if (!map_ptr_->isStateValid(g))
+      {
+        ROS_ERROR("[FMT*]: Goal pos collide or out of bound");
+        return false;
+      }
+
+      ROS_INFO("[FMT*]: FMT* starts planning a path");
+      sampler_.reset();
+      return fmt_star(s, g);
+    }
+
+    vector<Eigen::Vector3d> getPath()
+    {
+      return final_path_;
+    }
+
+    vector<vector<Eigen::Vector3d>> getAllPaths()
+    {
+      return path_list_;
+    }
+
+    vector<std::pair<double, double>> getSolutions()
+    {
+      return solution_cost_time_pair_list_;
+    }
+
+    vector<int> getSolutionIterations()
+    {
+      return solution_iteration_list_;
+    }
+
+    // see RRTStar::setCancelToken
+    void setCancelToken(const std::atomic<bool> *cancel_token)
+    {
+      cancel_token_ = cancel_token;
+    }
+
+    void setVisualizer(const std::shared_ptr<visualization::Visualization> &visPtr)
+    {
+      vis_ptr_ = visPtr;
+    };
+
+  private:
+    enum NodeState : uint8_t
+    {
+      UNVISITED = 0,
+      OPEN = 1,
+      CLOSED = 2
+    };
+    typedef std::pair<double, NodeId> OpenNode; // cost from start, node
+
+    ros::NodeHandle nh_;
+    BiasSampler sampler_;
+
+    int sample_num_;
+    double rewire_factor_;
+    double map_volume_;
+    double radius_;
+
+    RRTTree tree_; // every sample is a node, parent is set once it joins the tree
+    int node_nums_;
+    NodeId start_node_;
+    NodeId goal_node_;
+    kdtree *kd_tree_;
+    std::vector<uint8_t> state_;
+    // neighbours of a node within radius_, filled the first time they are needed
+    std::vector<std::vector<NodeId>> neighbours_;
+    std::vector<uint8_t> neighbours_ready_;
+
+    vector<Eigen::Vector3d> final_path_;
+    vector<vector<Eigen::Vector3d>> path_list_;
+    vector<std::pair<double, double>> solution_cost_time_pair_list_;
+    vector<int> solution_iteration_list_;
+
+    // environment
+    env::OccMap::Ptr map_ptr_;
+    env::SegmentCheckStats seg_check_stats_;
+    std::shared_ptr<visualization::Visualization> vis_ptr_;
+    const std::atomic<bool> *cancel_token_;
+
+    void reset()
+    {
+      for (int i = 0; i < node_nums_; ++i)
+        tree_.clearNode(i);
+      node_nums_ = 0;
+      kd_clear(kd_tree_);
+      final_path_.clear();
+      path_list_.clear();
+      solution_cost_time_pair_list_.clear();
+      solution_iteration_list_.clear();
+      seg_check_stats_.reset();
+    }
+
+    // candidates are drawn in blocks and validated with one batch query per block
+    void sampleFreeStates()
+    {
+      const int block = 1024;
+      const int max_blocks = 1000;
+      std::vector<double> xs(block), ys(block), zs(block);
+      std::vector<uint8_t> valid(block);
+      Eigen::Vector3d x;
+      for (int b = 0; b < max_blocks && node_nums_ < sample_num_ + 2; ++b)
+      {
+        for (int i = 0; i < block; ++i)
+        {
+          sampler_.uniformSamplingOnce(x);
+          xs[i] = x[0];
+          ys[i] = x[1];
+          zs[i] = x[2];
+        }
+        map_ptr_->isStateValidBatch(xs.data(), ys.data(), zs.data(), block, valid.data());
+        for (int i = 0; i < block && node_nums_ < sample_num_ + 2; ++i)
+        {
+          if (valid[i])
+            tree_.x[node_nums_++] = Eigen::Vector3d(xs[i], ys[i], zs[i]);
+        }
+      }
+    }
+
+    const std::vector<NodeId> &nearNodes(NodeId n)
+    {
+      if (!neighbours_ready_[n])
+      {
+        neighbours_ready_[n] = 1;
+        const Eigen::Vector3d &p = tree_.x[n];
+        struct kdres *nbr_set = kd_nearest_range3(kd_tree_, p[0], p[1], p[2], radius_);
+        while (nbr_set && !kd_res_end(nbr_set))
+        {
+          NodeId m = kdDataToNodeId(kd_res_item_data(nbr_set));
+          if (m != n)
+            neighbours_[n].push_back(m);
+          kd_res_next(nbr_set);
+        }
+        if (nbr_set)
+          kd_res_free(nbr_set);
+      }
+      return neighbours_[n];
+    }
+
+    void fillPath(NodeId n, vector<Eigen::Vector3d> &path)
+    {
+      path.clear();
+      for (NodeId node = n; node != NULL_NODE; node = tree_.parent[node])
+        path.push_back(tree_.x[node]);
+      std::reverse(std::begin(path), std::end(path));
+    }
+
+    bool cancelled() const
+    {
+      return cancel_token_ && cancel_token_->load(std::memory_order_relaxed);
+    }
+
+    bool fmt_star(const Eigen::Vector3d &s, const Eigen::Vector3d &g)
+    {
+      ros::Time fmt_start_time = ros::Time::now();
+
+      /* bulk construction: samples, kd-tree and the connection radius */
+      start_node_ = 0;
+      goal_node_ = 1;
+      tree_.x[start_node_] = s;
+      tree_.x[goal_node_] = g;
+      node_nums_ = 2;
+      sampleFreeStates();
+      for (int i = 0; i < node_nums_; ++i)
+        kd_insert3(kd_tree_, tree_.x[i][0], tree_.x[i][1], tree_.x[i][2], nodeIdToKdData(i));
+      double gamma = 2.0 * pow(1.0 + 1.0 / 3.0, 1.0 / 3.0) * pow(map_volume_ / (4.0 / 3.0 * M_PI), 1.0 / 3.0);
+      radius_ = rewire_factor_ * gamma * pow(log((double)node_nums_) / node_nums_, 1.0 / 3.0);
+      state_.assign(node_nums_, UNVISITED);
+      neighbours_.assign(node_nums_, std::vector<NodeId>());
+      neighbours_ready_.assign(node_nums_, 0);
+      double build_time = (ros::Time::now() - fmt_start_time).toSec();
+
+      /* march the wavefront */
+      std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>> open;
+      tree_.cost_from_start[start_node_] = 0.0;
+      state_[start_node_] = OPEN;
+      open.emplace(0.0, start_node_);
+      int iterations = 0;
+      bool goal_found = false;
+      while (!open.empty() && !cancelled())
+      {
+        NodeId z = open.top().second;
+        open.pop();
+        if (z == goal_node_)
+        {
+          goal_found = true;
+          break;
+        }
+        iterations++;
+
+        std::vector<NodeId> new_open;
+        for (const NodeId &x : nearNodes(z))
+        {
+          if (state_[x] != UNVISITED)
+            continue;
+          // the best open neighbour of x, only that edge is checked
+          NodeId y_min = NULL_NODE;
+          double c_min = DBL_MAX;
+          for (const NodeId &y : nearNodes(x))
+          {
+            if (state_[y] != OPEN)
+              continue;
+            double c = tree_.cost_from_start[y] + calDist(tree_.x[y], tree_.x[x]);
+            if (c < c_min)
+            {
+              c_min = c;
+              y_min = y;
+            }
+          }
+          if (y_min != NULL_NODE && map_ptr_->isSegmentValid(tree_.x[y_min], tree_.x[x], DBL_MAX, &seg_check_stats_))
+          {
+            tree_.link(x, y_min);
+            tree_.cost_from_start[x] = c_min;
+            tree_.cost_from_parent[x] = c_min - tree_.cost_from_start[y_min];
+            new_open.push_back(x);
+          }
+        }
+        // the new nodes join the open set only after z's neighbours are processed
+        for (const NodeId &x : new_open)
+        {
+          state_[x] = OPEN;
+          open.emplace(tree_.cost_from_start[x], x);
+        }
+        state_[z] = CLOSED;
+      }
+
+      vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> edges;
+      for (int i = 0; i < node_nums_; ++i)
+      {
+        if (tree_.parent[i] != NULL_NODE)
+          edges.emplace_back(tree_.x[tree_.parent[i]], tree_.x[i]);
+      }
+      vis_ptr_->visualize_pairline(edges, "tree_edges", visualization::Color::red, 0.04);
+
+      double use_time = (ros::Time::now() - fmt_start_time).toSec();
+      ROS_INFO_STREAM("[FMT*]: samples: " << node_nums_ << ", radius: " << radius_ << ", build time: " << build_time
+                      << " s, total time: " << use_time << " s, segment checks: " << seg_check_stats_.segments);
+      if (goal_found)
+      {
+        fillPath(goal_node_, final_path_);
+        path_list_.push_back(final_path_);
+        solution_cost_time_pair_list_.emplace_back(tree_.cost_from_start[goal_node_], use_time);
+        solution_iteration_list_.push_back(iterations);
+        ROS_INFO_STREAM("[FMT*]: path length: " << tree_.cost_from_start[goal_node_] << ", use_time: " << use_time);
+      }
+      else
+      {
+        ROS_ERROR_STREAM("[FMT*]: NOT CONNECTED TO GOAL with " << node_nums_ << " samples");
+      }
+      return goal_found;
+    }
+  };
+} // namespace path_plan
+
+#endif
@@ -25,19 +25,150 @@ OF SUCH DAMAGE.
 #include <iostream>
 #include <Eigen/Eigen>
 #include <utility>
+#include <vector>
+#include <stdint.h>
 
-struct TreeNode
+typedef uint32_t NodeId;
+const NodeId NULL_NODE = UINT32_MAX;
+
+// the tree is stored as structure of arrays, a node is the index into every array
+// children are linked intrusively: first child of a node and a doubly-linked sibling list
+struct RRTTree
 {
-	EIGEN_MAKE_ALIGNED_OPERATOR_NEW; //分配字节对齐的地址
-	TreeNode() : parent(NULL), cost_from_start(DBL_MAX), cost_from_parent(0.0){};
-	TreeNode *parent;
-	Eigen::Vector3d x;
-	double cost_from_start;
-	double cost_from_parent;
-	std::list<TreeNode *> children;
+	void resize(int node_nums)
+	{
+		x.resize(node_nums);
+		parent.assign(node_nums, NULL_NODE);
+		cost_from_start.assign(node_nums, DBL_MAX);
+		cost_from_parent.assign(node_nums, 0.0);
+		cost_stamp.assign(node_nums, 0);
+		cost_checked.assign(node_nums, 0);
+		first_child.assign(node_nums, NULL_NODE);
+		next_sibling.assign(node_nums, NULL_NODE);
+		prev_sibling.assign(node_nums, NULL_NODE);
+	}
+	int size() const { return parent.size(); }
+
+	void clearNode(NodeId n)
+	{
+		parent[n] = NULL_NODE;
+		first_child[n] = NULL_NODE;
+		next_sibling[n] = NULL_NODE;
+		prev_sibling[n] = NULL_NODE;
+	}
+
+	// set the parent of n (n must not have one) and push n to the front of its children
+	void link(NodeId n, NodeId p)
+	{
+		parent[n] = p;
+		prev_sibling[n] = NULL_NODE;
+		next_sibling[n] = first_child[p];
+		if (first_child[p] != NULL_NODE)
+			prev_sibling[first_child[p]] = n;
+		first_child[p] = n;
+	}
+
+	// detach n from its parent in O(1), its own subtree stays attached to it
+	void unlink(NodeId n)
+	{
+		NodeId p = parent[n];
+		if (p == NULL_NODE)
+			return;
+		if (prev_sibling[n] != NULL_NODE)
+			next_sibling[prev_sibling[n]] = next_sibling[n];
+		else
+			first_child[p] = next_sibling[n];
+		if (next_sibling[n] != NULL_NODE)
+			prev_sibling[next_sibling[n]] = prev_sibling[n];
+		parent[n] = NULL_NODE;
+		next_sibling[n] = NULL_NODE;
+		prev_sibling[n] = NULL_NODE;
+	}
+
+	std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d>> x;
+	std::vector<NodeId> parent;
+	std::vector<double> cost_from_start;
+	std::vector<double> cost_from_parent;
+	// lazy costs: the version of the path from the root cost_from_start was computed for, and the
+	// last rewire epoch in which it was found exact
+	std::vector<uint32_t> cost_stamp;
+	std::vector<uint32_t> cost_checked;
+	std::vector<NodeId> first_child;
+	std::vector<NodeId> next_sibling;
+	std::vector<NodeId> prev_sibling;
 };
-typedef TreeNode *RRTNode3DPtr;
-typedef std::vector<RRTNode3DPtr, Eigen::aligned_allocator<RRTNode3DPtr>> RRTNode3DPtrVector;
-typedef std::vector<TreeNode, Eigen::aligned_allocator<TreeNode>> RRTNode3DVector;
+
+// helpers shared by the planners
+
+inline double calDist(const Eigen::Vector3d &p1, const Eigen::Vector3d &p2)
+{
+	return (p1 - p2).norm();
+}
+
+// the point at most len from nearest_node_p toward rand_node_p
+inline Eigen::Vector3d steer(const Eigen::Vector3d &nearest_node_p, const Eigen::Vector3d &rand_node_p, double len)
+{
+	Eigen::Vector3d diff_vec = rand_node_p - nearest_node_p;
+	double dist = diff_vec.norm();
+	if (dist <= len)
+		return rand_node_p;
+	else
+		return nearest_node_p + diff_vec * len / dist; // len单步长度, dist是实际的距离
+}
+
+// move node under parent and update the cost from start of its whole subtree, stack is scratch
+// space kept by the caller so that rewiring never allocates. Returns the number of descendants updated
+inline int changeNodeParent(RRTTree &tree, NodeId node, NodeId parent, double cost_from_parent, std::vector<NodeId> &stack)
+{
+	tree.unlink(node); //DON'T FORGET THIS, remove it from its parent's children list
+	tree.link(node, parent);
+	tree.cost_from_parent[node] = cost_from_parent;
+	tree.cost_from_start[node] = tree.cost_from_start[parent] + cost_from_parent;
+
+	int updates = 0;
+	stack.clear();
+	stack.push_back(node);
+	while (!stack.empty())
+	{
+		NodeId descendant = stack.back();
+		stack.pop_back();
+		for (NodeId leaf = tree.first_child[descendant]; leaf != NULL_NODE; leaf = tree.next_sibling[leaf])
+		{
+			tree.cost_from_start[leaf] = tree.cost_from_parent[leaf] + tree.cost_from_start[descendant];
+			stack.push_back(leaf);
+			updates++;
+		}
+	}
+	return updates;
+}
+
+// the prolate hyperspheroid of the paths through foci1 and foci2 shorter than a2
+inline void calInformedSet(double a2, const Eigen::Vector3d &foci1, const Eigen::Vector3d &foci2,
+													 Eigen::Vector3d &scale, Eigen::Vector3d &trans, Eigen::Matrix3d &rot)
+{
+	trans = (foci1 + foci2) / 2.0;
+
+	scale[0] = a2 / 2.0;
+	Eigen::Vector3d diff(foci2 - foci1);
+	double c_square = diff.squaredNorm() / 4.0;
+	scale[1] = sqrt(scale[0] * scale[0] - c_square);
+	scale[2] = scale[1];
+
+	rot.col(0) = diff.normalized();
+	diff[2] = 0.0;
+	// project to the x-y plane and then rotate 90 degree;
+	rot.col(1) = Eigen::AngleAxisd(0.5 * M_PI, Eigen::Vector3d::UnitZ()) * diff.normalized();
+	rot.col(2) = rot.col(0).cross(rot.col(1));
+}
+
+// the kd-tree stores the node id in place of its data pointer
+inline void *nodeIdToKdData(NodeId id)
+{
+	return (void *)(uintptr_t)id;
+}
+inline NodeId kdDataToNodeId(void *data)
+{
+	return (NodeId)(uintptr_t)data;
+}
 
 #endif
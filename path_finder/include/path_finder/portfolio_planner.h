@@ -0,0 +1,210 @@
+/*
+Copyright (C) 2022 Hongkai Ye (kyle_yeh@163.com)
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+#ifndef PORTFOLIO_PLANNER_H
+#define PORTFOLIO_PLANNER_H
+
+#include "occ_grid/occ_map.h"
+#include "visualization/visualization.hpp"
+#include "rrt_star.h"
+
+#include <ros/ros.h>
+#include <utility>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <random>
+
+namespace path_plan
+{
+  // instance_num independent RRT* instances race on as many threads over the same read-only map.
+  // They differ in their random seeds only and share the best solution cost, so every instance
+  // samples inside the informed set of the best solution any of them has found. The best path wins.
+  class ParallelPortfolioPlanner
+  {
+  public:
+    ParallelPortfolioPlanner(){};
+    ParallelPortfolioPlanner(const ros::NodeHandle &nh, const env::OccMap::Ptr &mapPtr) : nh_(nh), map_ptr_(mapPtr)
+    {
+      nh_.param("Portfolio/instance_num", instance_num_, 4);
+
+      ROS_WARN_STREAM("[Portfolio] param: instance_num: " << instance_num_);
+
+      // the instances read the RRT_Star params, they get no visualizer as they plan concurrently
+      std::random_device rd;
+      for (int k = 0; k < instance_num_; ++k)
+      {
+        instances_.emplace_back(new RRTStar(nh_, mapPtr));
+        instances_.back()->seed(((uint64_t)rd() << 32) ^ rd());
+        instances_.back()->setSharedBestCost(&best_cost_);
+      }
+    }
+    ~ParallelPortfolioPlanner(){};
+
+    bool plan(const Eigen::Vector3d &s, const Eigen::Vector3d &g)
+    {
+      final_path_.clear();
+      path_list_.clear();
+      solution_cost_time_pair_list_.clear();
+      solution_iteration_list_.clear();
+      best_cost_ = DBL_MAX;
+
+      ROS_INFO("[Portfolio]: %d RRT* instances start planning a path", instance_num_);
+      std::vector<uint8_t> solved(instance_num_, 0);
+      std::vector<std::thread> threads;
+      threads.reserve(instance_num_);
+      for (int k = 0; k < instance_num_; ++k)
+        threads.emplace_back([this, k, &s, &g, &solved] { solved[k] = instances_[k]->plan(s, g); });
+      for (std::thread &thread : threads)
+        thread.join();
+
+      // all the instances start together, so their solution times can be merged directly:
+      // the portfolio's solutions are the ones that improved on every earlier solution of any instance
+      std::vector<SolutionRef> solutions;
+      int best_instance = -1;
+      double best_cost = DBL_MAX;
+      for (int k = 0; k < instance_num_; ++k)
+      {
+        if (!solved[k])
+          continue;
+        vector<std::pair<double, double>> slns = instances_[k]->getSolutions();
+        for (size_t i = 0; i < slns.size(); ++i)
+          solutions.push_back({slns[i].second, slns[i].first, k, (int)i});
+        if (slns.back().first < best_cost)
+        {
+          best_cost = slns.back().first;
+          best_instance = k;
+        }
+      }
+      if (best_instance < 0)
+      {
+        ROS_ERROR_STREAM("[Portfolio]: none of the " << instance_num_ << " instances connected to the goal");
+        return false;
+      }
+
+      std::sort(solutions.begin(), solutions.end(),
+                [](const SolutionRef &a, const SolutionRef &b) { return a.time < b.time; });
+      std::vector<vector<vector<Eigen::Vector3d>>> paths(instance_num_);
+      std::vector<vector<int>> iterations(instance_num_);
+      for (int k = 0; k < instance_num_; ++k)
+      {
+        if (!solved[k])
+          continue;
+        paths[k] = instances_[k]->getAllPaths();
+        iterations[k] = instances_[k]->getSolutionIterations();
+      }
+      for (const SolutionRef &sln : solutions)
+      {
+        if (!solution_cost_time_pair_list_.empty() && sln.cost >= solution_cost_time_pair_list_.back().first)
+          continue;
+        solution_cost_time_pair_list_.emplace_back(sln.cost, sln.time);
+        solution_iteration_list_.push_back(iterations[sln.instance][sln.index]);
+        path_list_.push_back(paths[sln.instance][sln.index]);
+      }
+      final_path_ = instances_[best_instance]->getPath();
+
+      // the spread of the instances is the spread a single RRT* would have on this query
+      double sum = 0.0, sq_sum = 0.0;
+      int solved_nums = 0;
+      std::stringstream costs;
+      vector<vector<Eigen::Vector3d>> final_paths;
+      for (int k = 0; k < instance_num_; ++k)
+      {
+        if (!solved[k])
+        {
+          costs << " -";
+          continue;
+        }
+        double cost = instances_[k]->getSolutions().back().first;
+        costs << " " << cost;
+        sum += cost;
+        sq_sum += cost * cost;
+        solved_nums++;
+        final_paths.push_back(instances_[k]->getPath());
+      }
+      double mean = sum / solved_nums;
+      ROS_INFO_STREAM("[Portfolio]: instance costs:" << costs.str() << ", mean: " << mean << ", std: "
+                      << sqrt(std::max(0.0, sq_sum / solved_nums - mean * mean)) << ", best: " << best_cost
+                      << " from instance " << best_instance);
+      if (vis_ptr_)
+        vis_ptr_->visualize_path_list(final_paths, "portfolio_paths", visualization::green);
+      return true;
+    }
+
+    vector<Eigen::Vector3d> getPath()
+    {
+      return final_path_;
+    }
+
+    vector<vector<Eigen::Vector3d>> getAllPaths()
+    {
+      return path_list_;
+    }
+
+    vector<std::pair<double, double>> getSolutions()
+    {
+      return solution_cost_time_pair_list_;
+    }
+
+    vector<int> getSolutionIterations()
+    {
+      return solution_iteration_list_;
+    }
+
+    // cancels all the instances together
+    void setCancelToken(const std::atomic<bool> *cancel_token)
+    {
+      for (std::unique_ptr<RRTStar> &instance : instances_)
+        instance->setCancelToken(cancel_token);
+    }
+
+    void setVisualizer(const std::shared_ptr<visualization::Visualization> &visPtr)
+    {
+      vis_ptr_ = visPtr;
+    };
+
+  private:
+    struct SolutionRef
+    {
+      double time;
+      double cost;
+      int instance;
+      int index; // in the solution list of the instance
+    };
+
+    ros::NodeHandle nh_;
+
+    int instance_num_;
+    std::vector<std::unique_ptr<RRTStar>> instances_;
+    std::atomic<double> best_cost_; // shared by all the instances
+
+    vector<Eigen::Vector3d> final_path_;
+    vector<vector<Eigen::Vector3d>> path_list_;
+    vector<std::pair<double, double>> solution_cost_time_pair_list_;
+    vector<int> solution_iteration_list_;
+
+    // environment
+    env::OccMap::Ptr map_ptr_;
+    std::shared_ptr<visualization::Visualization> vis_ptr_;
+  };
+
+} // namespace path_plan
+
+#endif
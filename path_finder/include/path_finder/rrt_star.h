@@ -26,78 +26,285 @@ OF SUCH DAMAGE.
 #include "sampler.h"
 #include "node.h"
 #include "kdtree.h"
+#include "spsc_queue.h"
+#include "thread_pool.h"
 
 #include <ros/ros.h>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
 #include <utility>
 #include <queue>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <time.h>
 
 namespace path_plan
 {
   class RRTStar
   {
   public:
-    RRTStar(){};
-    RRTStar(const ros::NodeHandle &nh, const env::OccMap::Ptr &mapPtr) : nh_(nh), map_ptr_(mapPtr)
+    RRTStar() : shared_best_cost_(nullptr), cancel_token_(nullptr), kd_tree_(nullptr){};
+    RRTStar(const ros::NodeHandle &nh, const env::OccMap::Ptr &mapPtr) : nh_(nh), shared_best_cost_(nullptr), cancel_token_(nullptr), map_ptr_(mapPtr)
     {
       nh_.param("RRT_Star/steer_length", steer_length_, 0.0);
       nh_.param("RRT_Star/search_radius", search_radius_, 0.0);
       nh_.param("RRT_Star/search_time", search_time_, 0.0);
       nh_.param("RRT_Star/max_tree_node_nums", max_tree_node_nums_, 0);
       nh_.param("RRT_Star/use_informed_sampling", use_informed_sampling_, true);
+      nh_.param("RRT_Star/lazy_cost_propagation", lazy_cost_propagation_, false);
+      nh_.param("RRT_Star/use_tree_pruning", use_tree_pruning_, false);
+      nh_.param("RRT_Star/prune_interval", prune_interval_, 1000);
+      nh_.param("RRT_Star/anytime_mode", anytime_mode_, false);
+      nh_.param("RRT_Star/reuse_tree", reuse_tree_, false);
+      nh_.param("RRT_Star/goal_bias", goal_bias_, 0.0);
+      nh_.param("RRT_Star/path_bias", path_bias_, 0.0);
+      nh_.param("RRT_Star/path_bias_sigma", path_bias_sigma_, 1.0);
+      nh_.param("RRT_Star/use_sample_rejection", use_sample_rejection_, false);
+      nh_.param("RRT_Star/free_space_sampling", free_space_sampling_, false);
+      nh_.param("RRT_Star/sequence_type", sequence_type_, 0);
+      nh_.param("RRT_Star/batch_sampling", batch_sampling_, false);
+      nh_.param("RRT_Star/bridge_ratio", bridge_ratio_, 0.0);
+      nh_.param("RRT_Star/gaussian_ratio", gaussian_ratio_, 0.0);
+      nh_.param("RRT_Star/obstacle_sigma", obstacle_sigma_, 1.0);
+      nh_.param("RRT_Star/thread_num", thread_num_, 1);
+      nh_.param("RRT_Star/pipeline_producers", pipeline_producers_, 0);
+      nh_.param("RRT_Star/check_threads", check_threads_, 1);
+      nh_.param("RRT_Star/parallel_check_threshold", parallel_check_threshold_, 16);
 
       ROS_WARN_STREAM("[RRT*] param: steer_length: " << steer_length_);
       ROS_WARN_STREAM("[RRT*] param: search_radius: " << search_radius_);
       ROS_WARN_STREAM("[RRT*] param: search_time: " << search_time_);
       ROS_WARN_STREAM("[RRT*] param: max_tree_node_nums: " << max_tree_node_nums_);
       ROS_WARN_STREAM("[RRT*] param: use_informed_sampling: " << use_informed_sampling_);
+      ROS_WARN_STREAM("[RRT*] param: lazy_cost_propagation: " << lazy_cost_propagation_);
+      ROS_WARN_STREAM("[RRT*] param: use_tree_pruning: " << use_tree_pruning_);
+      ROS_WARN_STREAM("[RRT*] param: prune_interval: " << prune_interval_);
+      ROS_WARN_STREAM("[RRT*] param: anytime_mode: " << anytime_mode_);
+      ROS_WARN_STREAM("[RRT*] param: reuse_tree: " << reuse_tree_);
+      ROS_WARN_STREAM("[RRT*] param: goal_bias: " << goal_bias_);
+      ROS_WARN_STREAM("[RRT*] param: path_bias: " << path_bias_);
+      ROS_WARN_STREAM("[RRT*] param: path_bias_sigma: " << path_bias_sigma_);
+      ROS_WARN_STREAM("[RRT*] param: use_sample_rejection: " << use_sample_rejection_);
+      ROS_WARN_STREAM("[RRT*] param: free_space_sampling: " << free_space_sampling_);
+      ROS_WARN_STREAM("[RRT*] param: sequence_type: " << sequence_type_);
+      ROS_WARN_STREAM("[RRT*] param: batch_sampling: " << batch_sampling_);
+      ROS_WARN_STREAM("[RRT*] param: bridge_ratio: " << bridge_ratio_);
+      ROS_WARN_STREAM("[RRT*] param: gaussian_ratio: " << gaussian_ratio_);
+      ROS_WARN_STREAM("[RRT*] param: obstacle_sigma: " << obstacle_sigma_);
+      ROS_WARN_STREAM("[RRT*] param: thread_num: " << thread_num_);
+      ROS_WARN_STREAM("[RRT*] param: pipeline_producers: " << pipeline_producers_);
+      ROS_WARN_STREAM("[RRT*] param: check_threads: " << check_threads_);
+      ROS_WARN_STREAM("[RRT*] param: parallel_check_threshold: " << parallel_check_threshold_);
+
+      // the parallel and the pipelined search never move or remove a node, so the tree maintenance is off
+      if ((thread_num_ > 1 || pipeline_producers_ > 0) && (lazy_cost_propagation_ || use_tree_pruning_ || anytime_mode_))
+      {
+        ROS_WARN_STREAM("[RRT*] lazy cost propagation, tree pruning and anytime mode are disabled with more than one thread");
+        lazy_cost_propagation_ = false;
+        use_tree_pruning_ = false;
+        anytime_mode_ = false;
+      }
 
       // set the range of sampling
       sampler_.setSamplingRange(mapPtr->getOrigin(), mapPtr->getMapSize());
+      sampler_.setBias(goal_bias_, path_bias_, path_bias_sigma_);
+      if (free_space_sampling_)
+        sampler_.setFreeSpaceMap(mapPtr);
+      sampler_.setSequenceType(sequence_type_);
+      sampler_.setBatchSampling(batch_sampling_);
+      sampler_.setObstacleSampling(mapPtr, bridge_ratio_, gaussian_ratio_, obstacle_sigma_);
 
       valid_tree_node_nums_ = 0;
-      nodes_pool_.resize(max_tree_node_nums_);
-      for (int i = 0; i < max_tree_node_nums_; ++i)
+      tree_node_end_ = 0;
+      prune_us_per_node_ = MAINTAIN_SEED_US_PER_NODE;
+      evict_us_per_node_ = MAINTAIN_SEED_US_PER_NODE;
+      cost_epoch_ = 1;
+      tree_.resize(max_tree_node_nums_);
+      descendant_stack_.reserve(max_tree_node_nums_);
+      free_nodes_.reserve(max_tree_node_nums_);
+      prune_keep_.assign(max_tree_node_nums_, 0);
+      kd_tree_ = kd_create(3);
+      if (check_threads_ > 1)
       {
-        nodes_pool_[i] = new TreeNode;
+        check_pool_.reset(new ThreadPool(check_threads_));
+        check_stats_.resize(check_threads_);
       }
     }
-    ~RRTStar(){};
+    ~RRTStar()
+    {
+      if (kd_tree_)
+        kd_free(kd_tree_);
+    };
 
     bool plan(const Eigen::Vector3d &s, const Eigen::Vector3d &g)
     {
-      // reset all the variable
-      reset();
+      return plan(s, vector<Eigen::Vector3d>(1, g));
+    }
+
+    // one tree from s toward all the goals, getGoalPaths() holds the best path to each of them and
+    // getPath() the cheapest of these. True once any goal is reached.
+    bool plan(const Eigen::Vector3d &s, const vector<Eigen::Vector3d> &goals)
+    {
+      if (!begin(s, goals))
+        return false;
+      if (thread_num_ > 1 && !multi_goal_)
+        return rrt_star_parallel();
+      if (pipeline_producers_ > 0 && !multi_goal_)
+        return rrt_star_pipelined();
+      iterate(search_time_ * 1e6);
+      return summarizeSearch(rrt_start_time_, goal_found_);
+    }
+
+    // resumable planning for callers that spread a query over their own cycles: begin() sets up the
+    // query, every iterate() keeps growing the same tree, bestPath() is the best path found so far.
+    // plan() is begin() and one iterate() of search_time_. iterate() runs the single threaded search.
+    bool begin(const Eigen::Vector3d &s, const Eigen::Vector3d &g)
+    {
+      return begin(s, vector<Eigen::Vector3d>(1, g));
+    }
+
+    // with several goals the search is the serial one, without tree reuse, pruning, anytime
+    // eviction and sample rejection, which all follow a single goal
+    bool begin(const Eigen::Vector3d &s, const vector<Eigen::Vector3d> &goals)
+    {
+      // reset all the variable, the tree itself is kept until we know whether it can be reused
+      resetSearchInfo();
       if (!map_ptr_->isStateValid(s))
       {
         ROS_ERROR("[RRT*]: Start pos collide or out of bound");
         return false;
       }
-      if (!map_ptr_->isStateValid(g))
+      if (goals.empty())
       {
-        ROS_ERROR("[RRT*]: Goal pos collide or out of bound");
+        ROS_ERROR("[RRT*]: No goal given");
         return false;
       }
-      /* construct start and goal nodes */
-      start_node_ = nodes_pool_[1];
-      start_node_->x = s;
-      start_node_->cost_from_start = 0.0;
-
-      goal_node_ = nodes_pool_[0];
-      goal_node_->x = g;
-      goal_node_->cost_from_start = DBL_MAX; // important
-      valid_tree_node_nums_ = 2;             // put start and goal in the tree
+      // the start and every goal take a node of the tree
+      if ((int)goals.size() > max_tree_node_nums_ - 1)
+      {
+        ROS_ERROR_STREAM("[RRT*]: " << goals.size() << " goals do not fit in a tree of " << max_tree_node_nums_ << " nodes");
+        return false;
+      }
+      for (const Eigen::Vector3d &goal : goals)
+      {
+        if (!map_ptr_->isStateValid(goal))
+        {
+          ROS_ERROR_STREAM("[RRT*]: Goal pos " << goal.transpose() << " collide or out of bound");
+          return false;
+        }
+      }
+      multi_goal_ = goals.size() > 1;
+      if (multi_goal_ && (thread_num_ > 1 || pipeline_producers_ > 0 || reuse_tree_ || use_tree_pruning_ || anytime_mode_ || use_sample_rejection_))
+        ROS_WARN_STREAM("[RRT*]: " << goals.size() << " goals, searching with one thread, without tree reuse, pruning, anytime eviction and sample rejection");
+      const Eigen::Vector3d &g = goals[0];
+
+      releaseGoalNodes();
+      warm_started_ = reuse_tree_ && !multi_goal_ && warmStart(s, g);
+      if (!warm_started_)
+      {
+        reset();
+        /* construct start and goal nodes */
+        start_node_ = 1;
+        tree_.x[start_node_] = s;
+        tree_.cost_from_start[start_node_] = 0.0;
+
+        goal_node_ = 0;
+        tree_.x[goal_node_] = g;
+        tree_.cost_from_start[goal_node_] = DBL_MAX; // important
+        valid_tree_node_nums_ = 2;             // put start and goal in the tree
+        tree_node_end_ = 2;
+
+        //Add start node to kd tree
+        kd_insert3(kd_tree_, s[0], s[1], s[2], nodeIdToKdData(start_node_));
+        kd_node_nums_ = 1;
+      }
+      // the other goals are leaves like the first one and stay out of the kd-tree as well
+      goal_nodes_.assign(1, goal_node_);
+      for (size_t i = 1; i < goals.size(); ++i)
+      {
+        NodeId goal_node = allocNode();
+        tree_.clearNode(goal_node);
+        tree_.x[goal_node] = goals[i];
+        tree_.cost_from_start[goal_node] = DBL_MAX;
+        goal_nodes_.push_back(goal_node);
+      }
+      goal_costs_.assign(goals.size(), DBL_MAX);
+      goal_paths_.clear();
 
       ROS_INFO("[RRT*]: RRT starts planning a path");
       
       // !------------
       sampler_.reset(); // firstly don't use the informed sampling, only in find the first solution case
-      if (use_informed_sampling_)
+      sampler_.setGoal(g);
+      if (use_informed_sampling_ && !multi_goal_)
       {
         calInformedSet(10000000000.0, s, g, scale_, trans_, rot_);
         sampler_.setInformedTransRot(trans_, rot_);
       }
       // !----------------
-      return rrt_star(s, g);
+
+      // the state of the search carried from one iterate() to the next
+      rrt_start_time_ = ros::Time::now();
+      c_square_ = (g - s).squaredNorm() / 4.0; // 相当于不开平方
+      goal_found_ = false;
+      iteration_ = 0;
+      last_prune_idx_ = 0;
+      last_prune_cost_ = DBL_MAX;
+      next_report_time_ = 1.0;
+
+      // a reused tree may already reach the new goal
+      if (warm_started_ && connectGoalToTree())
+      {
+        first_path_use_time_ = (ros::Time::now() - rrt_start_time_).toSec();
+        goal_found_ = true;
+        storeSolution(rrt_start_time_, c_square_, 0);
+      }
+      return true;
+    }
+
+    // grow the tree for at most budget_us microseconds, the call returns at the latest one extension
+    // after the deadline. A pruning or eviction pass only starts when its estimate, the cost per node
+    // of the last pass times the current node count, fits in the remaining budget, otherwise it waits
+    // for a later call. The only exception is a full tree at the
+    // start of a call: nothing can be added until the pass ran, so it runs anyway and the call may
+    // overrun by one pass, which happens only when the budget is shorter than that pass.
+    // The deadline is read from steady_clock, a vDSO call that, unlike ros::Time::now(), takes no
+    // lock and does not follow a simulated clock. True once a path exists.
+    bool iterate(double budget_us)
+    {
+      std::chrono::steady_clock::time_point deadline =
+          std::chrono::steady_clock::now() + std::chrono::microseconds((int64_t)budget_us);
+      bool first = true;
+      while (std::chrono::steady_clock::now() < deadline && !cancelled())
+      {
+        if (pruneDue() || evictDue())
+        {
+          double estimate_us = ((pruneDue() ? prune_us_per_node_ : 0.0) + (evictDue() ? evict_us_per_node_ : 0.0)) * valid_tree_node_nums_;
+          double remaining_us = std::chrono::duration<double, std::micro>(deadline - std::chrono::steady_clock::now()).count();
+          bool tree_full = valid_tree_node_nums_ >= max_tree_node_nums_;
+          if (estimate_us <= remaining_us || (first && tree_full))
+            maintainTree();
+          else if (tree_full)
+            break;
+        }
+        if (!(anytime_mode_ && !multi_goal_) && valid_tree_node_nums_ >= max_tree_node_nums_)
+          break;
+        if (!extendTree())
+          break;
+        first = false;
+      }
+      return goal_found_;
+    }
+
+    vector<Eigen::Vector3d> bestPath()
+    {
+      vector<Eigen::Vector3d> path;
+      if (goal_found_)
+        fillPath(goal_node_, path);
+      return path;
     }
 
     vector<Eigen::Vector3d> getPath()
@@ -105,6 +312,17 @@ namespace path_plan
       return final_path_;
     }
 
+    // by goal of the last query, empty for the goals not reached
+    vector<vector<Eigen::Vector3d>> getGoalPaths()
+    {
+      return goal_paths_;
+    }
+
+    vector<double> getGoalCosts()
+    {
+      return goal_costs_;
+    }
+
     vector<vector<Eigen::Vector3d>> getAllPaths()
     {
       return path_list_;
@@ -115,6 +333,46 @@ namespace path_plan
       return solution_cost_time_pair_list_;
     }
 
+    vector<int> getSolutionIterations()
+    {
+      return solution_iteration_list_;
+    }
+
+    // time spent rewiring and number of cost_from_start updates of the last query
+    double getRewireTime()
+    {
+      return rewire_time_;
+    }
+
+    long getCostUpdates()
+    {
+      return cost_updates_;
+    }
+
+    // a solution cost shared with other planners solving the same query, e.g. the instances of a
+    // portfolio: this search publishes its solutions to it and shrinks its informed set to it
+    void setSharedBestCost(std::atomic<double> *shared_best_cost)
+    {
+      shared_best_cost_ = shared_best_cost;
+    }
+
+    void seed(uint64_t s)
+    {
+      sampler_.seed(s);
+    }
+
+    // a flag owned by the caller, e.g. an asynchronous front end: once it is set the search in
+    // progress stops at its next iteration and the query ends with the best path found so far
+    void setCancelToken(const std::atomic<bool> *cancel_token)
+    {
+      cancel_token_ = cancel_token;
+    }
+
+    bool cancelled() const
+    {
+      return cancel_token_ && cancel_token_->load(std::memory_order_relaxed);
+    }
+
     // only for edge and the point in the search process
     void setVisualizer(const std::shared_ptr<visualization::Visualization> &visPtr)
     {
@@ -128,6 +386,74 @@ namespace path_plan
     // Biased sampling
     BiasSampler sampler_;
 
+    // goal biased and path biased sampling
+    double goal_bias_, path_bias_, path_bias_sigma_;
+
+    // reject samples and steered states by their admissible f-value once a solution exists
+    bool use_sample_rejection_;
+    long rejected_sample_nums_;
+    long rejected_steered_nums_;
+
+    // draw samples from the free voxel index of the map
+    bool free_space_sampling_;
+
+    // 0: pseudo random, 1: halton, 2: sobol, 3: scrambled sobol
+    int sequence_type_;
+    bool batch_sampling_;
+
+    // bridge test and gaussian obstacle based sampling for narrow passages
+    double bridge_ratio_, gaussian_ratio_, obstacle_sigma_;
+
+    // parallel search: the worker threads share the tree, queries and collision checks run
+    // under a shared lock or without any, only the insertion and the rewiring are exclusive
+    int thread_num_;
+    boost::shared_mutex tree_mutex_;
+    std::atomic<double> best_cost_;
+    std::atomic<int> solution_version_;
+
+    // pipelined search: producer threads sample, steer and check edges against their own copy
+    // of the kd-tree, the planning thread owns the tree and only chooses parents and rewires
+    static const int PIPELINE_QUEUE_SIZE = 64;
+    int pipeline_producers_;
+    struct PipelineEdges
+    {
+      NodeId node;
+      int8_t to_new;   // edge node -> x_new: 1 valid, 0 blocked, -1 not checked
+      int8_t from_new; // edge x_new -> node, for the rewiring
+      bool operator<(const PipelineEdges &other) const { return node < other.node; }
+    };
+    struct PipelineCandidate
+    {
+      Eigen::Vector3d x_new;
+      NodeId nearest_node;
+      vector<PipelineEdges> neighbours; // the neighbours in the snapshot, sorted by id
+    };
+    struct PipelineNode
+    {
+      NodeId node;
+      Eigen::Vector3d x;
+      double cost_from_start; // at insertion, later rewires only lower it
+    };
+
+    // the edges of a new node with at least parallel_check_threshold_ neighbours are checked on
+    // check_pool_ before the serial choose-parent and rewire loops, which only read the results
+    int check_threads_;
+    int parallel_check_threshold_;
+    long parallel_check_nums_;
+    std::unique_ptr<ThreadPool> check_pool_;
+    vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> check_edges_;
+    vector<int> check_index_;     // the neighbour of each edge in check_edges_
+    vector<std::pair<double, int>> check_order_;
+    vector<uint8_t> check_valid_; // the result of each edge in check_edges_
+    vector<int8_t> edge_valid_;   // by neighbour: 1 valid, 0 blocked, -1 not checked
+    vector<env::SegmentCheckStats> check_stats_; // by pool thread
+
+    // the cost behind the current informed set, it may come from another planner
+    std::atomic<double> *shared_best_cost_;
+    double informed_cost_;
+
+    const std::atomic<bool> *cancel_token_;
+
     // for informed sampling
     Eigen::Vector3d trans_, scale_;
     Eigen::Matrix3d rot_;
@@ -137,314 +463,525 @@ namespace path_plan
     double search_radius_;
     double search_time_;
 
+    // lazy cost propagation: a rewire sets the exact cost of the rewired node only and gives it a
+    // new version, its descendants are refreshed when their cost is read
+    bool lazy_cost_propagation_;
+    uint32_t cost_epoch_;
+    std::vector<NodeId> cost_path_;
+    long cost_updates_;
+    double rewire_time_;
+
+    // informed pruning, the slots of pruned nodes are recycled through free_nodes_
+    bool use_tree_pruning_;
+    int prune_interval_;
+    int prune_nums_;
+    long pruned_node_nums_;
+    std::vector<NodeId> free_nodes_;
+    std::vector<uint8_t> prune_keep_;
+
+    // anytime mode: keep planning with a full tree by evicting the least useful leaves
+    static constexpr double EVICT_RATIO = 0.05;
+    // estimate of both passes before the first one was timed, about twice the worst measured on one core
+    static constexpr double MAINTAIN_SEED_US_PER_NODE = 2.0;
+    bool anytime_mode_;
+    long evicted_node_nums_;
+    int kd_node_nums_;
+
+    // warm start: the tree of the last query is re-rooted at the new start
+    bool reuse_tree_;
+    bool warm_started_;
+
     int max_tree_node_nums_;
-    int valid_tree_node_nums_;
+    int valid_tree_node_nums_; // nodes in the tree
+    int tree_node_end_;        // one past the highest slot ever used in this plan
 
     double first_path_use_time_;
     double final_path_use_time_;
 
-    std::vector<TreeNode *> nodes_pool_;
-    TreeNode *start_node_;
-    TreeNode *goal_node_;
+    // the search state kept between the iterate() calls
+    ros::Time rrt_start_time_;
+    double c_square_; // 相当于不开平方
+    bool goal_found_;
+
+    // all the goals of the query, goal_node_ is the first one or, with several goals, the cheapest
+    // one reached so far; goal_costs_ is the cost of the best path to each goal, DBL_MAX until reached
+    bool multi_goal_;
+    vector<NodeId> goal_nodes_;
+    vector<double> goal_costs_;
+    vector<vector<Eigen::Vector3d>> goal_paths_;
+    int iteration_;
+    int last_prune_idx_;
+    double last_prune_cost_;
+    // duration per tree node of the last pruning and eviction pass, kept across queries
+    double prune_us_per_node_;
+    double evict_us_per_node_;
+    double next_report_time_;
+
+    RRTTree tree_;
+    kdtree *kd_tree_;
+    std::vector<NodeId> descendant_stack_;
+    NodeId start_node_;
+    NodeId goal_node_;
 
     vector<Eigen::Vector3d> final_path_;
     vector<vector<Eigen::Vector3d>> path_list_;
     vector<std::pair<double, double>> solution_cost_time_pair_list_;  // 存放终点到起点的dist以及程序已经运行的时间
+    vector<int> solution_iteration_list_; // the main loop iteration of each solution
 
     // environment
     env::OccMap::Ptr map_ptr_;
+    env::SegmentCheckStats seg_check_stats_;
     std::shared_ptr<visualization::Visualization> vis_ptr_;
 
     void reset()
     {
-      final_path_.clear();
-      path_list_.clear();
-      solution_cost_time_pair_list_.clear();
-      for (int i = 0; i < valid_tree_node_nums_; i++)
+      resetSearchInfo();
+      for (int i = 0; i < tree_node_end_; i++)
       {
-        nodes_pool_[i]->parent = nullptr;
-        nodes_pool_[i]->children.clear();
+        tree_.clearNode(i);
       }
       valid_tree_node_nums_ = 0;
+      tree_node_end_ = 0;
+      free_nodes_.clear();
+      goal_nodes_.clear();
+      kd_clear(kd_tree_);
+      kd_node_nums_ = 0;
+    }
+
+    // the goals of the last query other than goal_node_ are leaves out of the kd-tree, they are
+    // kept for getGoalPaths() and bestPath() until the next query; warmStart() handles goal_node_
+    void releaseGoalNodes()
+    {
+      for (const NodeId &goal : goal_nodes_)
+      {
+        if (goal == goal_node_)
+          continue;
+        tree_.unlink(goal);
+        tree_.clearNode(goal);
+        free_nodes_.push_back(goal);
+        valid_tree_node_nums_--;
+      }
+      goal_nodes_.clear();
     }
 
-    double calDist(const Eigen::Vector3d &p1, const Eigen::Vector3d &p2)
+    void resetSearchInfo()
     {
-      return (p1 - p2).norm();
+      final_path_.clear();
+      path_list_.clear();
+      solution_cost_time_pair_list_.clear();
+      solution_iteration_list_.clear();
+      seg_check_stats_.reset();
+      cost_updates_ = 0;
+      rewire_time_ = 0.0;
+      prune_nums_ = 0;
+      pruned_node_nums_ = 0;
+      evicted_node_nums_ = 0;
+      rejected_sample_nums_ = 0;
+      rejected_steered_nums_ = 0;
+      best_cost_ = DBL_MAX;
+      solution_version_ = 0;
+      informed_cost_ = DBL_MAX;
+      parallel_check_nums_ = 0;
     }
 
-    Eigen::Vector3d steer(const Eigen::Vector3d &nearest_node_p, const Eigen::Vector3d &rand_node_p, double len)
+    // take a slot from the free list or from the unused end of the arrays
+    NodeId allocNode()
     {
-      Eigen::Vector3d diff_vec = rand_node_p - nearest_node_p;
-      double dist = diff_vec.norm();
-      if (diff_vec.norm() <= len)
-        return rand_node_p;
+      NodeId new_node;
+      if (!free_nodes_.empty())
+      {
+        new_node = free_nodes_.back();
+        free_nodes_.pop_back();
+      }
       else
-        return nearest_node_p + diff_vec * len / dist;  // len单步长度, dist是实际的距离
+      {
+        new_node = tree_node_end_++;
+      }
+      valid_tree_node_nums_++;
+      return new_node;
     }
 
-    RRTNode3DPtr addTreeNode(RRTNode3DPtr &parent, const Eigen::Vector3d &state,
-                             const double &cost_from_start, const double &cost_from_parent)
+    NodeId addTreeNode(NodeId parent, const Eigen::Vector3d &state,
+                       const double &cost_from_start, const double &cost_from_parent)
     {
-      RRTNode3DPtr new_node_ptr = nodes_pool_[valid_tree_node_nums_];
-      valid_tree_node_nums_++; // 树的节点变加一,因为实现了随机采样扩展
-      new_node_ptr->parent = parent;
-      parent->children.push_back(new_node_ptr);
-      new_node_ptr->x = state;
-      new_node_ptr->cost_from_start = cost_from_start;
-      new_node_ptr->cost_from_parent = cost_from_parent;
-      return new_node_ptr;
+      NodeId new_node = allocNode(); // 树的节点变加一,因为实现了随机采样扩展
+      tree_.link(new_node, parent);
+      tree_.x[new_node] = state;
+      tree_.cost_from_start[new_node] = cost_from_start;
+      tree_.cost_from_parent[new_node] = cost_from_parent;
+      if (lazy_cost_propagation_)
+      {
+        costFromStart(parent); // brings the version of the parent up to date
+        tree_.cost_stamp[new_node] = tree_.cost_stamp[parent];
+        tree_.cost_checked[new_node] = cost_epoch_;
+      }
+      return new_node;
     }
 
-    void changeNodeParent(RRTNode3DPtr &node, RRTNode3DPtr &parent, const double &cost_from_parent)
+    void changeNodeParent(NodeId node, NodeId parent, const double &cost_from_parent)
     {
-      if(node->parent) // 指针是否为空
-        node->parent->children.remove(node); //DON'T FORGET THIS, remove it from its parent's children list
-      
-      node->parent = parent;
-      node->cost_from_parent = cost_from_parent;
-      node->cost_from_start = parent->cost_from_start + cost_from_parent;
-      parent->children.push_back(node);
+      if (!lazy_cost_propagation_)
+      {
+        cost_updates_ += ::changeNodeParent(tree_, node, parent, cost_from_parent, descendant_stack_);
+        return;
+      }
+
+      tree_.unlink(node); //DON'T FORGET THIS, remove it from its parent's children list
+      tree_.link(node, parent);
+      tree_.cost_from_parent[node] = cost_from_parent;
+      tree_.cost_from_start[node] = costFromStart(parent) + cost_from_parent;
+      // a leaf has nothing to invalidate, a subtree gets a new version, older than which its
+      // descendants are stale, in O(1) whatever its size
+      if (tree_.first_child[node] == NULL_NODE)
+        tree_.cost_stamp[node] = tree_.cost_stamp[parent];
+      else
+        tree_.cost_stamp[node] = ++cost_epoch_;
+      tree_.cost_checked[node] = cost_epoch_;
+    }
 
-      // for all its descendants, change the cost_from_start and tau_from_start;
-      RRTNode3DPtr descendant(node);
-      std::queue<RRTNode3DPtr> Q;
-      Q.push(descendant);
-      while (!Q.empty())
+    // exact cost from start of a node. With lazy propagation the path is climbed up to the first
+    // node found exact since the last rewire, or to the root, then walked down: a node older than
+    // the newest version above it is recomputed. Between two rewires a node is only checked once.
+    double costFromStart(NodeId n)
+    {
+      if (!lazy_cost_propagation_ || tree_.cost_checked[n] == cost_epoch_)
+        return tree_.cost_from_start[n];
+
+      cost_path_.clear();
+      NodeId node = n;
+      // a node without parent (start, or goal not connected yet) always holds its exact cost
+      while (tree_.cost_checked[node] != cost_epoch_ && tree_.parent[node] != NULL_NODE)
+      {
+        cost_path_.push_back(node);
+        node = tree_.parent[node];
+      }
+      uint32_t stamp = tree_.cost_stamp[node];
+      tree_.cost_checked[node] = cost_epoch_;
+      while (!cost_path_.empty())
       {
-        descendant = Q.front();
-        Q.pop();
-        for (const auto &leafptr : descendant->children)
+        node = cost_path_.back();
+        cost_path_.pop_back();
+        if (tree_.cost_stamp[node] < stamp)
         {
-          leafptr->cost_from_start = leafptr->cost_from_parent + descendant->cost_from_start;
-          Q.push(leafptr);
+          tree_.cost_from_start[node] = tree_.cost_from_start[tree_.parent[node]] + tree_.cost_from_parent[node];
+          tree_.cost_stamp[node] = stamp;
+          cost_updates_++;
         }
+        else
+        {
+          stamp = tree_.cost_stamp[node];
+        }
+        tree_.cost_checked[node] = cost_epoch_;
       }
+      return tree_.cost_from_start[n];
     }
 
     // Recursive acquisition path
-    void fillPath(const RRTNode3DPtr &n, vector<Eigen::Vector3d> &path)
+    void fillPath(NodeId n, vector<Eigen::Vector3d> &path)
     {
       path.clear();
-      RRTNode3DPtr node_ptr = n;
-      while (node_ptr->parent)
+      NodeId node = n;
+      while (tree_.parent[node] != NULL_NODE)
       {
-        path.push_back(node_ptr->x);
-        node_ptr = node_ptr->parent;
+        path.push_back(tree_.x[node]);
+        node = tree_.parent[node];
       }
-      path.push_back(start_node_->x);
+      path.push_back(tree_.x[start_node_]);
       std::reverse(std::begin(path), std::end(path));
     }
 
 
-    bool rrt_star(const Eigen::Vector3d &s, const Eigen::Vector3d &g)
+    // one iteration of the main loop of RRT*, false if the search can not go on
+    bool extendTree()
     {
-      ros::Time rrt_start_time = ros::Time::now();
-      bool goal_found = false;
-      double c_square = (g - s).squaredNorm() / 4.0; // 相当于不开平方
+      int idx = iteration_++;
+      if (anytime_mode_ && (idx & 255) == 0)
+      {
+        double use_time = (ros::Time::now() - rrt_start_time_).toSec();
+        if (use_time >= next_report_time_)
+        {
+          ROS_INFO_STREAM("[RRT*]: " << use_time << " s, nodes: " << valid_tree_node_nums_ << ", kd nodes: " << kd_node_nums_
+                          << ", evicted: " << evicted_node_nums_ << ", memory: " << memoryUsage() / 1024 << " KB");
+          next_report_time_ += 1.0;
+        }
+      }
+
+      if (shared_best_cost_ && use_informed_sampling_ && *shared_best_cost_ < informed_cost_)
+      {
+        shrinkInformedSet(*shared_best_cost_, c_square_);
+      }
 
-      /* kd tree init */
-      kdtree *kd_tree = kd_create(3);
-      //Add start and goal nodes to kd tree
-      kd_insert3(kd_tree, start_node_->x[0], start_node_->x[1], start_node_->x[2], start_node_);
+      /* biased random sampling */
+      Eigen::Vector3d x_rand;
+      sampler_.samplingOnce(x_rand);
 
-      /* main loop */
-      // satisfy the time and the number of nodes
-      for(int idx = 0; (ros::Time::now() - rrt_start_time).toSec() < search_time_ && valid_tree_node_nums_ < max_tree_node_nums_; ++idx)
+      // a sample whose admissible f-value can not beat the current solution is useless
+      if (use_sample_rejection_ && goal_found_ && !multi_goal_ &&
+          calDist(tree_.x[start_node_], x_rand) + calDist(x_rand, tree_.x[goal_node_]) >= costFromStart(goal_node_))
       {
-        /* biased random sampling */
-        Eigen::Vector3d x_rand;
-        sampler_.samplingOnce(x_rand);
+        rejected_sample_nums_++;
+        return true;
+      }
 
-        // is valid
-        if (!map_ptr_->isStateValid(x_rand))
-        {
-          continue;
-        }
+      // is valid
+      if (!map_ptr_->isStateValid(x_rand))
+      {
+        return true;
+      }
 
-        //  get the nearest for x_rand
-        struct kdres *p_nearest = kd_nearest3(kd_tree, x_rand[0], x_rand[1], x_rand[2]);
-        if(p_nearest == nullptr)
-        {
-          ROS_ERROR("nearest query error");
-          continue;
-        }
-        RRTNode3DPtr nearest_node = (RRTNode3DPtr)kd_res_item_data(p_nearest);
-        kd_res_free(p_nearest); // free this
+      //  get the nearest for x_rand
+      struct kdres *p_nearest = kd_nearest3(kd_tree_, x_rand[0], x_rand[1], x_rand[2]);
+      if(p_nearest == nullptr)
+      {
+        ROS_ERROR("nearest query error");
+        return true;
+      }
+      NodeId nearest_node = kdDataToNodeId(kd_res_item_data(p_nearest));
+      kd_res_free(p_nearest); // free this
 
-        // get the new expand node
-        Eigen::Vector3d x_new = steer(nearest_node->x, x_rand, steer_length_);
-        if (!map_ptr_->isSegmentValid(nearest_node->x, x_new))
+      // get the new expand node
+      Eigen::Vector3d x_new = steer(tree_.x[nearest_node], x_rand, steer_length_);
+
+      // the same test for the steered state. The cost through the nearest node is only an upper
+      // bound of its cost from start, choose-parent may find a cheaper neighbour, so it is not used.
+      if (use_sample_rejection_ && goal_found_ && !multi_goal_)
+      {
+        if (calDist(tree_.x[start_node_], x_new) + calDist(x_new, tree_.x[goal_node_]) >= costFromStart(goal_node_))
         {
-          continue;
+          rejected_steered_nums_++;
+          return true;
         }
+      }
 
-        /* 1. find parent */
-        /* kd_tree bounds search for parent */
-        vector<RRTNode3DPtr> neighbour_nodes; // store all the neighbor nodes
+      if (!map_ptr_->isSegmentValid(tree_.x[nearest_node], x_new, DBL_MAX, &seg_check_stats_))
+      {
+        return true;
+      }
 
-        struct kdres *nbr_set;
-        nbr_set = kd_nearest_range3(kd_tree, x_new[0], x_new[1], x_new[2], search_radius_);
-        if (nbr_set == nullptr)
+      /* 1. find parent */
+      /* kd_tree bounds search for parent */
+      vector<NodeId> neighbour_nodes; // store all the neighbor nodes
+
+      struct kdres *nbr_set;
+      nbr_set = kd_nearest_range3(kd_tree_, x_new[0], x_new[1], x_new[2], search_radius_);
+      if (nbr_set == nullptr)
+      {
+        ROS_ERROR("bkwd kd range query error");
+        return false;
+      }
+      while (!kd_res_end(nbr_set))
+      {
+        NodeId curr_node = kdDataToNodeId(kd_res_item_data(nbr_set));
+        neighbour_nodes.emplace_back(curr_node);
+        // store range query result so that we dont need to query again for rewire;
+        kd_res_next(nbr_set); //go to next in kd tree range query result
+      }
+      kd_res_free(nbr_set); //reset kd tree range query
+
+      /* choose parent from kd tree range query result*/
+      double dist2nearest = calDist(tree_.x[nearest_node], x_new);
+      double min_dist_from_start(costFromStart(nearest_node) + dist2nearest);
+      double cost_from_p(dist2nearest);   // cost from parent
+      NodeId min_node(nearest_node); //set the nearest_node as the default parent
+
+      // TODO Choose a parent according to potential cost-from-start values
+      // ! Hints:
+      // ! 1. Use map_ptr_->isSegmentValid(p1, p2) to check line edge validity;
+      // ! 2. Default parent is [nearest_node];
+      // ! 3. Store your chosen parent-node-pointer, the according cost-from-parent and cost-from-start
+      // !     in [min_node], [cost_from_p], and [min_dist_from_start] respectively;
+      // ! 4. [Optional] You can sort the potential parents first in increasing order by cost-from-start value;
+      // ! 5. [Optional] You can store the collison-checking results for later usage in the Rewire procedure.
+      // ! Implement your own code inside the following loop
+      // with many neighbours the edges that could beat the nearest node are checked on the pool in
+      // waves, cheapest first, up to the wave holding the first valid one. That one is the parent the
+      // loop below picks, as it does with serial checks; the unchecked edges count as blocked.
+      bool parallel_checks = check_pool_ && (int)neighbour_nodes.size() >= parallel_check_threshold_;
+      if (parallel_checks)
+      {
+        check_order_.clear();
+        for (size_t i = 0; i < neighbour_nodes.size(); ++i)
         {
-          ROS_ERROR("bkwd kd range query error");
-          break;
+          double cost = costFromStart(neighbour_nodes[i]) + calDist(tree_.x[neighbour_nodes[i]], x_new);
+          if (cost < min_dist_from_start)
+            check_order_.emplace_back(cost, i);
         }
-        while (!kd_res_end(nbr_set))
+        std::sort(check_order_.begin(), check_order_.end()); // equal costs keep the neighbour order
+        edge_valid_.assign(neighbour_nodes.size(), -1);
+        size_t wave = 2 * check_pool_->threadNum();
+        bool parent_found = false;
+        for (size_t begin = 0; begin < check_order_.size() && !parent_found; begin += wave)
         {
-          RRTNode3DPtr curr_node = (RRTNode3DPtr)kd_res_item_data(nbr_set);
-          neighbour_nodes.emplace_back(curr_node);
-          // store range query result so that we dont need to query again for rewire;
-          kd_res_next(nbr_set); //go to next in kd tree range query result
-        }
-        kd_res_free(nbr_set); //reset kd tree range query
-
-        /* choose parent from kd tree range query result*/
-        double dist2nearest = calDist(nearest_node->x, x_new);
-        double min_dist_from_start(nearest_node->cost_from_start + dist2nearest);
-        double cost_from_p(dist2nearest);   // cost from parent
-        RRTNode3DPtr min_node(nearest_node); //set the nearest_node as the default parent
-
-        // TODO Choose a parent according to potential cost-from-start values
-        // ! Hints:
-        // ! 1. Use map_ptr_->isSegmentValid(p1, p2) to check line edge validity;
-        // ! 2. Default parent is [nearest_node];
-        // ! 3. Store your chosen parent-node-pointer, the according cost-from-parent and cost-from-start
-        // !     in [min_node], [cost_from_p], and [min_dist_from_start] respectively;
-        // ! 4. [Optional] You can sort the potential parents first in increasing order by cost-from-start value;
-        // ! 5. [Optional] You can store the collison-checking results for later usage in the Rewire procedure.
-        // ! Implement your own code inside the following loop
-        for (auto &curr_node : neighbour_nodes)
-        {
-          double dist2current = calDist(curr_node->x, x_new);
-          double current_dist_from_start = curr_node->cost_from_start + dist2current;
-          if (current_dist_from_start < min_dist_from_start)
+          check_edges_.clear();
+          check_index_.clear();
+          for (size_t j = begin; j < std::min(begin + wave, check_order_.size()); ++j)
           {
-            if (map_ptr_->isSegmentValid(curr_node->x, x_new))
-            {
-              min_node = curr_node;
-              cost_from_p = dist2current;  //cost from parent
-              min_dist_from_start = current_dist_from_start;
-            }
+            check_edges_.emplace_back(tree_.x[neighbour_nodes[check_order_[j].second]], x_new);
+            check_index_.push_back(check_order_[j].second);
+          }
+          checkEdgesInParallel();
+          for (size_t j = 0; j < check_index_.size(); ++j)
+            parent_found = parent_found || check_valid_[j];
+        }
+      }
+      for (size_t i = 0; i < neighbour_nodes.size(); ++i)
+      {
+        const NodeId &curr_node = neighbour_nodes[i];
+        double dist2current = calDist(tree_.x[curr_node], x_new);
+        double current_dist_from_start = costFromStart(curr_node) + dist2current;
+        if (current_dist_from_start < min_dist_from_start)
+        {
+          if (parallel_checks ? edge_valid_[i] == 1 : map_ptr_->isSegmentValid(tree_.x[curr_node], x_new, DBL_MAX, &seg_check_stats_))
+          {
+            min_node = curr_node;
+            cost_from_p = dist2current;  //cost from parent
+            min_dist_from_start = current_dist_from_start;
           }
         }
+      }
 
-        /* parent found within radius, then add a node to rrt and kd_tree */
-        /* 1.1 add the randomly sampled node to rrt_tree */
-        RRTNode3DPtr new_node(nullptr);
-        new_node = addTreeNode(min_node, x_new, min_dist_from_start, cost_from_p);
+      /* parent found within radius, then add a node to rrt and kd_tree */
+      /* 1.1 add the randomly sampled node to rrt_tree */
+      NodeId new_node = addTreeNode(min_node, x_new, min_dist_from_start, cost_from_p);
 
-        /* 1.2 add the randomly sampled node to kd_tree */
-        kd_insert3(kd_tree, x_new[0], x_new[1], x_new[2], new_node);
-        // end of find parent
+      /* 1.2 add the randomly sampled node to kd_tree */
+      kd_insert3(kd_tree_, x_new[0], x_new[1], x_new[2], nodeIdToKdData(new_node));
+      kd_node_nums_++;
+      // end of find parent
 
-        /* 2. try to connect to goal if possible */
-        double dist_to_goal = calDist(x_new, goal_node_->x);
+      /* 2. try to connect to goal if possible */
+      for (const NodeId &goal : goal_nodes_)
+      {
+        double dist_to_goal = calDist(x_new, tree_.x[goal]);
         // less than one range
-        if (dist_to_goal <= search_radius_)
+        if (dist_to_goal > search_radius_)
+          continue;
+        // can this node connect the end point directly
+        bool is_connected2goal = map_ptr_->isSegmentValid(x_new, tree_.x[goal], DBL_MAX, &seg_check_stats_);
+
+        // this test can be omitted if sample-rejction is applied
+        // first the cost from start of the goal node is very great
+        // we can update the goal node if we can find a better solution
+        bool is_better_path = costFromStart(goal) > dist_to_goal + costFromStart(new_node);
+        if (is_connected2goal && is_better_path)
         {
-          // can this node connect the end point directly
-          bool is_connected2goal = map_ptr_->isSegmentValid(x_new, goal_node_->x);
-
-          // this test can be omitted if sample-rejction is applied
-          // first the cost from start of the goal node is very great
-          // we can update the goal node if we can find a better solution
-          bool is_better_path = goal_node_->cost_from_start > dist_to_goal + new_node->cost_from_start;
-          if (is_connected2goal && is_better_path)
+          // The end point is not found by default
+          if (!goal_found_)
           {
-            // The end point is not found by default
-            if (!goal_found)
-            {
-              first_path_use_time_ = (ros::Time::now() - rrt_start_time).toSec();
-            }
-            goal_found = true;
-            changeNodeParent(goal_node_, new_node, dist_to_goal);
-
-            // store the path
-            vector<Eigen::Vector3d> curr_best_path;
-            fillPath(goal_node_, curr_best_path);
-            path_list_.emplace_back(curr_best_path);
-
-            // store the cost and the total time to now
-            solution_cost_time_pair_list_.emplace_back(goal_node_->cost_from_start, (ros::Time::now() - rrt_start_time).toSec());
-
-            // ----------informed RRT*
-            if (use_informed_sampling_)
-            {
-              scale_[0] = goal_node_->cost_from_start / 2.0;
-              scale_[1] = sqrt(scale_[0] * scale_[0] - c_square);
-              scale_[2] = scale_[1];
-              sampler_.setInformedSacling(scale_); // set true and the scale begin informed rrt*
-
-              std::vector<visualization::ELLIPSOID> ellps;
-              ellps.emplace_back(trans_, scale_, rot_);
-              vis_ptr_->visualize_ellipsoids(ellps, "informed_set", visualization::yellow, 0.2);
-            }
-            // ! ---------------------
+            first_path_use_time_ = (ros::Time::now() - rrt_start_time_).toSec();
           }
+          goal_found_ = true;
+          changeNodeParent(goal, new_node, dist_to_goal);
+          if (multi_goal_)
+            updateGoalSolutions(idx);
+          else
+            storeSolution(rrt_start_time_, c_square_, idx);
         }
+      }
 
-        /* 3.rewire */
-        // TODO Rewire according to potential cost-from-start values
-        // ! Hints:
-        // !  1. Use map_ptr_->isSegmentValid(p1, p2) to check line edge validity;
-        // !  2. Use changeNodeParent(node, parent, cost_from_parent) to change a node's parent;
-        // !  3. the variable [new_node] is the pointer of X_new;
-        // !  4. [Optional] You can test whether the node is promising before checking edge collison.
-        // ! Implement your own code between the dash lines [--------------] in the following loop
-        for (auto &curr_node : neighbour_nodes)
-        {
-          double best_cost_before_rewire = goal_node_->cost_from_start;
-          // ! -------------------------------------
-          double dist_to_child = calDist(new_node->x, curr_node->x);
-          double current_dist_from_new = new_node->cost_from_start + dist_to_child;
-          
-          // add in order to reduce unnecessary Rewire (learn from hkye)
-          // but the result is not very fascinating
-          // heuristic as Euclidean
-          double promising_cost  = current_dist_from_new + calDist(curr_node->x, goal_node_->x);
-          if (current_dist_from_new < curr_node->cost_from_start && promising_cost < best_cost_before_rewire)
+      /* 3.rewire */
+      // TODO Rewire according to potential cost-from-start values
+      // ! Hints:
+      // !  1. Use map_ptr_->isSegmentValid(p1, p2) to check line edge validity;
+      // !  2. Use changeNodeParent(node, parent, cost_from_parent) to change a node's parent;
+      // !  3. the variable [new_node] is the pointer of X_new;
+      // !  4. [Optional] You can test whether the node is promising before checking edge collison.
+      // ! Implement your own code between the dash lines [--------------] in the following loop
+      ros::WallTime rewire_start_time = ros::WallTime::now();
+      // costs only drop while rewiring, so the edges passing the test now are a superset of the
+      // ones the loop will check
+      if (parallel_checks)
+      {
+        edge_valid_.assign(neighbour_nodes.size(), -1);
+        check_edges_.clear();
+        check_index_.clear();
+        for (size_t i = 0; i < neighbour_nodes.size(); ++i)
+        {
+          const Eigen::Vector3d &curr_x = tree_.x[neighbour_nodes[i]];
+          double current_dist_from_new = costFromStart(new_node) + calDist(x_new, curr_x);
+          if (current_dist_from_new < costFromStart(neighbour_nodes[i]) && mayImproveGoal(curr_x, current_dist_from_new))
+          {
+            check_edges_.emplace_back(x_new, curr_x);
+            check_index_.push_back(i);
+          }
+        }
+        checkEdgesInParallel();
+      }
+      for (size_t i = 0; i < neighbour_nodes.size(); ++i)
+      {
+        const NodeId &curr_node = neighbour_nodes[i];
+        double best_cost_before_rewire = costFromStart(goal_node_);
+        // ! -------------------------------------
+        double dist_to_child = calDist(tree_.x[new_node], tree_.x[curr_node]);
+        double current_dist_from_new = costFromStart(new_node) + dist_to_child;
+        
+        // add in order to reduce unnecessary Rewire (learn from hkye)
+        // but the result is not very fascinating
+        // heuristic as Euclidean
+        if (current_dist_from_new < costFromStart(curr_node) && mayImproveGoal(tree_.x[curr_node], current_dist_from_new))
+        {
+          if (parallel_checks ? edge_valid_[i] == 1 : map_ptr_->isSegmentValid(tree_.x[new_node], tree_.x[curr_node], DBL_MAX, &seg_check_stats_))
           {
-            if (map_ptr_->isSegmentValid(new_node->x, curr_node->x))
+            changeNodeParent(curr_node, new_node, dist_to_child);
+
+            // if could get a better solution
+            // after the changeNodeParent, the goal_node_'s cost from start may change
+            // we use heuristic to estimate, but heuristic is less than the actual value
+            if (multi_goal_)
+            {
+              updateGoalSolutions(idx);
+            }
+            else if (best_cost_before_rewire > costFromStart(goal_node_))
             {
-              changeNodeParent(curr_node, new_node, calDist(new_node->x, curr_node->x));
-
-              // if could get a better solution
-              // after the changeNodeParent, the goal_node_'s cost from start may change
-              // we use heuristic to estimate, but heuristic is less than the actual value
-              if (best_cost_before_rewire > goal_node_->cost_from_start)
-              {
-                vector<Eigen::Vector3d> curr_best_path;
-                fillPath(goal_node_, curr_best_path);
-                path_list_.emplace_back(curr_best_path);
-                solution_cost_time_pair_list_.emplace_back(goal_node_->cost_from_start, (ros::Time::now() - rrt_start_time).toSec());
-
-                //informed RRT*
-                if (use_informed_sampling_)
-                {
-                  scale_[0] = goal_node_->cost_from_start / 2.0;
-                  scale_[1] = sqrt(scale_[0] * scale_[0] - c_square);
-                  scale_[2] = scale_[1];
-                  sampler_.setInformedSacling(scale_); // set true(begin informed rrt*) and set scale
-
-                  std::vector<visualization::ELLIPSOID> ellps;
-                  ellps.emplace_back(trans_, scale_, rot_);
-                  vis_ptr_->visualize_ellipsoids(ellps, "informed_set", visualization::yellow, 0.2);
-                }
-              }
+              storeSolution(rrt_start_time_, c_square_, idx);
             }
           }
-          // ! -------------------------------------
         }
-        /* end of rewire */
+        // ! -------------------------------------
+      }
+      rewire_time_ += (ros::WallTime::now() - rewire_start_time).toSec();
+      /* end of rewire */
+
+      /* 4. informed pruning and eviction run between the extensions, see iterate() */
+
+      // !-------------
+      /* vector<Eigen::Vector3d> vertice;
+      vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> edges;
+      sampleWholeTree(vertice, edges);
+
+      std::vector<visualization::BALL> balls;
+      balls.reserve(vertice.size());
+      visualization::BALL node_p;
+      node_p.radius = 0.06;
+      for (size_t i = 0; i < vertice.size(); ++i)
+      {
+        node_p.center = vertice[i];
+        balls.push_back(node_p);
+      }
+
+      // 可视化采样的节点和连接采样点之间的路径
+      vis_ptr_->visualize_balls(balls, "tree_vertice", visualization::Color::blue, 1.0);
+      vis_ptr_->visualize_pairline(edges, "tree_edges", visualization::Color::red, 0.04); */
+      // !-------------
+
+      return true;
+    }
 
-        // !-------------
-        /* vector<Eigen::Vector3d> vertice;
+    // visualize the tree, log the statistics of the search and extract the final path
+    bool summarizeSearch(const ros::Time &rrt_start_time, bool goal_found)
+    {
+      // a cancelled query is not drawn, the one that replaced it is waiting
+      if (vis_ptr_ && !cancelled())
+      {
+        vector<Eigen::Vector3d> vertice;
         vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> edges;
-        sampleWholeTree(start_node_, vertice, edges);
+        sampleWholeTree(vertice, edges);
 
+        // balls display all the nodes in search process
         std::vector<visualization::BALL> balls;
         balls.reserve(vertice.size());
+
+        //add every node to balls
         visualization::BALL node_p;
         node_p.radius = 0.06;
         for (size_t i = 0; i < vertice.size(); ++i)
@@ -455,36 +992,34 @@ namespace path_plan
 
         // 可视化采样的节点和连接采样点之间的路径
         vis_ptr_->visualize_balls(balls, "tree_vertice", visualization::Color::blue, 1.0);
-        vis_ptr_->visualize_pairline(edges, "tree_edges", visualization::Color::red, 0.04); */
-        // !-------------
-
-      }
-      /* end of sample once */
-
-      vector<Eigen::Vector3d> vertice;
-      vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> edges;
-      sampleWholeTree(start_node_, vertice, edges);
+        vis_ptr_->visualize_pairline(edges, "tree_edges", visualization::Color::red, 0.04);
 
-      // balls display all the nodes in search process
-      std::vector<visualization::BALL> balls;
-      balls.reserve(vertice.size());
-
-      //add every node to balls
-      visualization::BALL node_p;
-      node_p.radius = 0.06;
-      for (size_t i = 0; i < vertice.size(); ++i)
-      {
-        node_p.center = vertice[i];
-        balls.push_back(node_p);
+        std::vector<visualization::ELLIPSOID> ellps;
+        if (!multi_goal_)
+          ellps.emplace_back(trans_, scale_, rot_);
+        vis_ptr_->visualize_ellipsoids(ellps, "informed_set", visualization::yellow, 0.2);
       }
 
-      // 可视化采样的节点和连接采样点之间的路径
-      vis_ptr_->visualize_balls(balls, "tree_vertice", visualization::Color::blue, 1.0);
-      vis_ptr_->visualize_pairline(edges, "tree_edges", visualization::Color::red, 0.04);
-
-      std::vector<visualization::ELLIPSOID> ellps;
-      ellps.emplace_back(trans_, scale_, rot_);
-      vis_ptr_->visualize_ellipsoids(ellps, "informed_set", visualization::yellow, 0.2);
+      double search_use_time = (ros::Time::now() - rrt_start_time).toSec();
+      if (cancelled())
+        ROS_WARN_STREAM("[RRT*]: search cancelled after " << search_use_time << " s");
+      ROS_INFO_STREAM("[RRT*]: rewire time: " << rewire_time_ << " s (" << 100.0 * rewire_time_ / search_use_time
+                      << "% of the search), cost updates: " << cost_updates_ << ", lazy: " << lazy_cost_propagation_);
+      if (use_informed_sampling_ && goal_found)
+        ROS_INFO_STREAM("[RRT*]: informed sampling rejection rate: " << sampler_.informedRejectionRate() << ", sampled from "
+                        << (multi_goal_ ? "the union of the goal ellipsoids" : sampler_.informedFromBox() ? "the bounding box" : "the ellipsoid"));
+      if (use_sample_rejection_)
+        ROS_INFO_STREAM("[RRT*]: rejected " << rejected_sample_nums_ << " samples and " << rejected_steered_nums_ << " steered states by cost");
+      if (anytime_mode_)
+        ROS_INFO_STREAM("[RRT*]: evicted " << evicted_node_nums_ << " nodes, memory: " << memoryUsage() / 1024 << " KB");
+      if (use_tree_pruning_)
+        ROS_INFO_STREAM("[RRT*]: pruned " << prune_nums_ << " times, " << pruned_node_nums_ << " nodes recycled, "
+                        << valid_tree_node_nums_ << " nodes in the tree");
+      if (check_pool_)
+        ROS_INFO_STREAM("[RRT*]: " << parallel_check_nums_ << " edges checked on " << check_pool_->threadNum() << " threads");
+      ROS_INFO_STREAM("[RRT*]: segment checks: " << seg_check_stats_.segments << ", rejected: " << seg_check_stats_.rejected
+                      << ", voxel lookups: " << seg_check_stats_.checks
+                      << ", expected lookups until rejection: " << seg_check_stats_.expectedChecksUntilRejection());
 
       if (goal_found)
       {
@@ -500,50 +1035,1040 @@ namespace path_plan
       {
         ROS_ERROR_STREAM("[RRT*]: NOT CONNECTED TO GOAL after " << (ros::Time::now() - rrt_start_time).toSec() << " seconds");
       }
+
+      goal_paths_.assign(goal_nodes_.size(), vector<Eigen::Vector3d>());
+      std::stringstream goal_costs;
+      for (size_t k = 0; k < goal_nodes_.size(); ++k)
+      {
+        if (tree_.parent[goal_nodes_[k]] == NULL_NODE)
+        {
+          goal_costs_[k] = DBL_MAX;
+          goal_costs << " -";
+          continue;
+        }
+        goal_costs_[k] = costFromStart(goal_nodes_[k]);
+        fillPath(goal_nodes_[k], goal_paths_[k]);
+        goal_costs << " " << goal_costs_[k];
+      }
+      if (multi_goal_)
+        ROS_INFO_STREAM("[RRT*]: costs to the " << goal_nodes_.size() << " goals:" << goal_costs.str());
       return goal_found;
     }
 
-    // vertice store the coordinate of all points
-    // edges store the coordinate corresponding to two points
-    void sampleWholeTree(const RRTNode3DPtr &root, vector<Eigen::Vector3d> &vertice, vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> &edges)
+    // multi-threaded RRT*: every thread samples, queries the kd-tree and checks the candidate
+    // edges against a snapshot of the neighbourhood taken under a shared lock; under the
+    // exclusive lock the parent is re-chosen with the current costs among the pre-checked
+    // edges, then the node is inserted and the neighbours are rewired.
+    // Nodes are never moved or removed, so a NodeId in a snapshot stays valid, and a cost can
+    // only decrease, so an edge found valid before the lock is still a correct candidate after it.
+    bool rrt_star_parallel()
     {
-      if (root == nullptr)
-        return;
-
-      // whatever dfs or bfs
-      RRTNode3DPtr node = root;
-      std::queue<RRTNode3DPtr> Q;
-      Q.push(node);
-      while (!Q.empty())
+      const ros::Time &rrt_start_time = rrt_start_time_;
+      double c_square = c_square_;
+      // the workers read the deadline from steady_clock, which unlike ros::Time::now() takes no lock
+      std::chrono::steady_clock::time_point deadline =
+          std::chrono::steady_clock::now() +
+          std::chrono::microseconds((int64_t)(1e6 * (search_time_ - (ros::Time::now() - rrt_start_time).toSec())));
+
+      std::atomic<bool> stop(false);
+      std::atomic<int> iteration(0);
+      std::vector<long> iterations(thread_num_, 0);
+      std::vector<double> exclusive_time(thread_num_, 0.0), lock_wait_time(thread_num_, 0.0), thread_time(thread_num_, 0.0);
+      std::vector<env::SegmentCheckStats> seg_check_stats(thread_num_);
+      std::vector<std::thread> workers;
+      workers.reserve(thread_num_);
+      for (int t = 0; t < thread_num_; ++t)
       {
-        // get and pop
-        node = Q.front();
-        Q.pop();
-        for (const auto &leafptr : node->children)
-        {
-          vertice.push_back(leafptr->x);
-          edges.emplace_back(std::make_pair(node->x, leafptr->x));
-          Q.push(leafptr);
-        }
+        // each thread owns a copy of the sampler, already set up for this query
+        BiasSampler sampler(sampler_);
+        if (t > 0)
+          sampler.seed(std::random_device()() + t);
+        workers.emplace_back(&RRTStar::parallelWorker, this, sampler, std::cref(rrt_start_time), deadline, c_square,
+                             std::ref(stop), std::ref(iteration), std::ref(iterations[t]), std::ref(exclusive_time[t]),
+                             std::ref(lock_wait_time[t]), std::ref(thread_time[t]), std::ref(seg_check_stats[t]));
       }
+      for (std::thread &worker : workers)
+        worker.join();
+
+      for (int t = 0; t < thread_num_; ++t)
+        seg_check_stats_.add(seg_check_stats[t]);
+      double search_use_time = (ros::Time::now() - rrt_start_time).toSec();
+      std::stringstream per_thread;
+      for (int t = 0; t < thread_num_; ++t)
+        per_thread << (t ? ", " : "") << iterations[t];
+      ROS_INFO_STREAM("[RRT*]: " << thread_num_ << " threads, " << iteration << " iterations (" << per_thread.str()
+                      << "), " << iteration / search_use_time << " iterations/s");
+      // the share of the work done under the exclusive lock bounds the speed-up on any core count
+      double exclusive_sum = 0.0, wait_sum = 0.0, thread_sum = 0.0;
+      for (int t = 0; t < thread_num_; ++t)
+      {
+        exclusive_sum += exclusive_time[t];
+        wait_sum += lock_wait_time[t];
+        thread_sum += thread_time[t];
+      }
+      double serial_share = std::min(1.0, exclusive_sum / std::max(thread_sum, 1e-9));
+      ROS_INFO_STREAM("[RRT*]: exclusive lock held for " << 100.0 * serial_share << "% of the cpu time, waited "
+                      << wait_sum << " s in total, speed-up bound: " << 1.0 / std::max(serial_share, 1e-9));
+
+      goal_found_ = tree_.parent[goal_node_] != NULL_NODE;
+      return summarizeSearch(rrt_start_time, goal_found_);
     }
 
-    void calInformedSet(double a2, const Eigen::Vector3d &foci1, const Eigen::Vector3d &foci2,
-                        Eigen::Vector3d &scale, Eigen::Vector3d &trans, Eigen::Matrix3d &rot)
+    void parallelWorker(BiasSampler sampler, const ros::Time &rrt_start_time, std::chrono::steady_clock::time_point deadline,
+                        double c_square, std::atomic<bool> &stop,
+                        std::atomic<int> &iteration, long &iterations, double &exclusive_time, double &lock_wait_time,
+                        double &thread_time, env::SegmentCheckStats &seg_check_stats)
     {
-      trans = (foci1 + foci2) / 2.0;
 
-      scale[0] = a2 / 2.0;
-      Eigen::Vector3d diff(foci2 - foci1);
-      double c_square = diff.squaredNorm() / 4.0;
-      scale[1] = sqrt(scale[0] * scale[0] - c_square);
-      scale[2] = scale[1];
+      const Eigen::Vector3d start_x = tree_.x[start_node_];
+      const Eigen::Vector3d goal_x = tree_.x[goal_node_];
+      int known_solution_version = -1;
+
+      // snapshot of the neighbourhood of x_new, ordered by the cost through each neighbour
+      vector<NodeId> neighbour_nodes;
+      vector<Eigen::Vector3d> neighbour_x;
+      vector<double> neighbour_cost;
+      vector<std::pair<double, int>> parent_order;
+      vector<NodeId> parent_candidates, rewire_candidates;
+
+      while (!stop)
+      {
+        if (std::chrono::steady_clock::now() >= deadline || cancelled())
+          break;
+        int idx = iteration++;
+        iterations++;
+
+        // follow the solutions found by the other threads
+        if (known_solution_version != solution_version_)
+        {
+          boost::shared_lock<boost::shared_mutex> lock(tree_mutex_);
+          known_solution_version = solution_version_;
+          if (!path_list_.empty())
+          {
+            sampler.setGoalReached();
+            sampler.setBiasPath(path_list_.back());
+            if (use_informed_sampling_)
+              sampler.setInformedSacling(scale_);
+          }
+        }
+        double best_cost = best_cost_;
 
-      rot.col(0) = diff.normalized();
-      diff[2] = 0.0;
-      // project to the x-y plane and then rotate 90 degree;
-      rot.col(1) = Eigen::AngleAxisd(0.5 * M_PI, Eigen::Vector3d::UnitZ()) * diff.normalized(); 
-      rot.col(2) = rot.col(0).cross(rot.col(1));
+        /* biased random sampling */
+        Eigen::Vector3d x_rand;
+        sampler.samplingOnce(x_rand);
+        if (use_sample_rejection_ && calDist(start_x, x_rand) + calDist(x_rand, goal_x) >= best_cost)
+          continue;
+        if (!map_ptr_->isStateValid(x_rand))
+          continue;
+
+        /* nearest node, steering and the neighbourhood of x_new, all read under the shared lock */
+        Eigen::Vector3d x_new, nearest_x;
+        NodeId nearest_node;
+        double nearest_cost;
+        neighbour_nodes.clear();
+        neighbour_x.clear();
+        neighbour_cost.clear();
+        {
+          boost::shared_lock<boost::shared_mutex> lock(tree_mutex_);
+          if (valid_tree_node_nums_ >= max_tree_node_nums_)
+            break;
+          struct kdres *p_nearest = kd_nearest3(kd_tree_, x_rand[0], x_rand[1], x_rand[2]);
+          if (p_nearest == nullptr)
+          {
+            ROS_ERROR("nearest query error");
+            continue;
+          }
+          nearest_node = kdDataToNodeId(kd_res_item_data(p_nearest));
+          kd_res_free(p_nearest);
+          nearest_x = tree_.x[nearest_node];
+          nearest_cost = tree_.cost_from_start[nearest_node];
+          x_new = steer(nearest_x, x_rand, steer_length_);
+
+          struct kdres *nbr_set = kd_nearest_range3(kd_tree_, x_new[0], x_new[1], x_new[2], search_radius_);
+          if (nbr_set == nullptr)
+          {
+            ROS_ERROR("bkwd kd range query error");
+            continue;
+          }
+          while (!kd_res_end(nbr_set))
+          {
+            NodeId curr_node = kdDataToNodeId(kd_res_item_data(nbr_set));
+            neighbour_nodes.push_back(curr_node);
+            neighbour_x.push_back(tree_.x[curr_node]);
+            neighbour_cost.push_back(tree_.cost_from_start[curr_node]);
+            kd_res_next(nbr_set);
+          }
+          kd_res_free(nbr_set);
+        }
+
+        double h = calDist(x_new, goal_x);
+        if (use_sample_rejection_ && calDist(start_x, x_new) + h >= best_cost)
+          continue;
+        if (!map_ptr_->isSegmentValid(nearest_x, x_new, DBL_MAX, &seg_check_stats))
+          continue;
+
+        /* 1. parent candidates: the nearest node and the cheapest valid neighbour, checked in order of cost */
+        parent_candidates.assign(1, nearest_node);
+        double new_cost = nearest_cost + calDist(nearest_x, x_new);
+        parent_order.clear();
+        for (size_t i = 0; i < neighbour_nodes.size(); ++i)
+        {
+          double cost = neighbour_cost[i] + calDist(neighbour_x[i], x_new);
+          if (cost < new_cost)
+            parent_order.emplace_back(cost, (int)i);
+        }
+        std::sort(parent_order.begin(), parent_order.end());
+        for (const std::pair<double, int> &candidate : parent_order)
+        {
+          int i = candidate.second;
+          if (map_ptr_->isSegmentValid(neighbour_x[i], x_new, DBL_MAX, &seg_check_stats))
+          {
+            parent_candidates.push_back(neighbour_nodes[i]);
+            new_cost = candidate.first;
+            break;
+          }
+        }
+
+        /* 2. and 3. pre-check the goal edge and the rewire edges against the snapshot costs */
+        bool goal_edge_valid = h <= search_radius_ && new_cost + h < best_cost &&
+                               map_ptr_->isSegmentValid(x_new, goal_x, DBL_MAX, &seg_check_stats);
+        rewire_candidates.clear();
+        for (size_t i = 0; i < neighbour_nodes.size(); ++i)
+        {
+          double dist_to_child = calDist(x_new, neighbour_x[i]);
+          if (new_cost + dist_to_child < neighbour_cost[i] &&
+              new_cost + dist_to_child + calDist(neighbour_x[i], goal_x) < best_cost &&
+              map_ptr_->isSegmentValid(x_new, neighbour_x[i], DBL_MAX, &seg_check_stats))
+            rewire_candidates.push_back(neighbour_nodes[i]);
+        }
+
+        /* insert and rewire with the current costs under the exclusive lock */
+        std::chrono::steady_clock::time_point lock_request = std::chrono::steady_clock::now();
+        boost::unique_lock<boost::shared_mutex> lock(tree_mutex_);
+        std::chrono::steady_clock::time_point locked = std::chrono::steady_clock::now();
+        lock_wait_time += std::chrono::duration<double>(locked - lock_request).count();
+        if (valid_tree_node_nums_ >= max_tree_node_nums_)
+          break;
+        bool solution_stored = false;
+
+        NodeId min_node = NULL_NODE;
+        double min_dist_from_start = DBL_MAX, cost_from_p = 0.0;
+        for (const NodeId &curr_node : parent_candidates)
+        {
+          double dist2current = calDist(tree_.x[curr_node], x_new);
+          if (tree_.cost_from_start[curr_node] + dist2current < min_dist_from_start)
+          {
+            min_node = curr_node;
+            cost_from_p = dist2current;
+            min_dist_from_start = tree_.cost_from_start[curr_node] + dist2current;
+          }
+        }
+
+        NodeId new_node = addTreeNode(min_node, x_new, min_dist_from_start, cost_from_p);
+        kd_insert3(kd_tree_, x_new[0], x_new[1], x_new[2], nodeIdToKdData(new_node));
+        kd_node_nums_++;
+
+        if (goal_edge_valid && tree_.cost_from_start[goal_node_] > h + tree_.cost_from_start[new_node])
+        {
+          if (path_list_.empty())
+            first_path_use_time_ = (ros::Time::now() - rrt_start_time).toSec();
+          changeNodeParent(goal_node_, new_node, h);
+          storeSolution(rrt_start_time, c_square, idx, false);
+          solution_stored = true;
+        }
+
+        ros::WallTime rewire_start_time = ros::WallTime::now();
+        for (const NodeId &curr_node : rewire_candidates)
+        {
+          double best_cost_before_rewire = tree_.cost_from_start[goal_node_];
+          double dist_to_child = calDist(tree_.x[new_node], tree_.x[curr_node]);
+          double current_dist_from_new = tree_.cost_from_start[new_node] + dist_to_child;
+          if (current_dist_from_new < tree_.cost_from_start[curr_node])
+          {
+            changeNodeParent(curr_node, new_node, dist_to_child);
+            if (best_cost_before_rewire > tree_.cost_from_start[goal_node_])
+            {
+              storeSolution(rrt_start_time, c_square, idx, false);
+              solution_stored = true;
+            }
+          }
+        }
+        rewire_time_ += (ros::WallTime::now() - rewire_start_time).toSec();
+        Eigen::Vector3d informed_scale = scale_;
+        exclusive_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - locked).count();
+        lock.unlock();
+
+        // the solution is stored, publishing it does not hold up the other threads
+        if (solution_stored && use_informed_sampling_)
+          visualizeInformedSet(informed_scale);
+      }
+      stop = true;
+      // cpu time, so that time slicing on fewer cores than threads does not dilute the share
+      timespec cpu_time;
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_time);
+      thread_time = cpu_time.tv_sec + 1e-9 * cpu_time.tv_nsec;
+    }
+
+    // pipelined RRT*: pipeline_producers_ threads draw samples that pass the validity and cost
+    // tests, steer them from the nearest node of their own snapshot of the tree and check the
+    // edges from all the snapshot neighbours. The planning thread owns the tree: it takes the
+    // candidates from one SPSC queue per producer, chooses the parent, inserts, connects to the
+    // goal and rewires, checking only the edges the snapshot did not cover. Every inserted node
+    // goes back to the producers through a second queue per producer.
+    // Nodes are never moved or removed, so a snapshot is a subset of the tree: its nearest node
+    // is a valid fallback parent and its edge checks stay correct.
+    bool rrt_star_pipelined()
+    {
+      const ros::Time &rrt_start_time = rrt_start_time_;
+      bool goal_found = goal_found_;
+      double c_square = c_square_;
+
+      // the snapshots start from the nodes in the kd-tree, the goal is not one of them
+      vector<PipelineNode> initial_nodes;
+      for (int n = 0; n < tree_node_end_; ++n)
+      {
+        if (n != (int)goal_node_ && (n == (int)start_node_ || tree_.parent[n] != NULL_NODE))
+          initial_nodes.push_back({(NodeId)n, tree_.x[n], costFromStart(n)});
+      }
+
+      // a node queue never fills up, every node ever inserted fits in it
+      std::atomic<bool> stop(false);
+      std::vector<std::unique_ptr<SPSCQueue<PipelineCandidate>>> candidate_queues;
+      std::vector<std::unique_ptr<SPSCQueue<PipelineNode>>> node_queues;
+      std::vector<env::SegmentCheckStats> producer_stats(pipeline_producers_);
+      std::vector<std::thread> producers;
+      for (int t = 0; t < pipeline_producers_; ++t)
+      {
+        candidate_queues.emplace_back(new SPSCQueue<PipelineCandidate>(PIPELINE_QUEUE_SIZE));
+        node_queues.emplace_back(new SPSCQueue<PipelineNode>(max_tree_node_nums_));
+      }
+      for (int t = 0; t < pipeline_producers_; ++t)
+      {
+        BiasSampler sampler(sampler_);
+        sampler.seed(std::random_device()() + t);
+        producers.emplace_back(&RRTStar::pipelineProducer, this, sampler, std::cref(initial_nodes), c_square,
+                               std::ref(*node_queues[t]), std::ref(*candidate_queues[t]), std::ref(stop), std::ref(producer_stats[t]));
+      }
+
+      const Eigen::Vector3d start_x = tree_.x[start_node_];
+      const Eigen::Vector3d goal_x = tree_.x[goal_node_];
+      vector<NodeId> neighbour_nodes;
+      PipelineCandidate candidate;
+      int next_queue = 0;
+      long snapshot_neighbours = 0, missing_neighbours = 0, idle_nums = 0;
+      int idx = 0;
+
+      /* main loop, the planning thread only consumes candidates */
+      while ((ros::Time::now() - rrt_start_time).toSec() < search_time_ && valid_tree_node_nums_ < max_tree_node_nums_ && !cancelled())
+      {
+        bool received = false;
+        for (int i = 0; i < pipeline_producers_ && !received; ++i)
+        {
+          received = candidate_queues[next_queue]->pop(candidate);
+          next_queue = (next_queue + 1) % pipeline_producers_;
+        }
+        if (!received)
+        {
+          idle_nums++;
+          std::this_thread::yield();
+          continue;
+        }
+        idx++;
+
+        // the candidate may have been drawn before the last improvement
+        const Eigen::Vector3d &x_new = candidate.x_new;
+        if (use_sample_rejection_ && goal_found &&
+            calDist(start_x, x_new) + calDist(x_new, goal_x) >= costFromStart(goal_node_))
+        {
+          rejected_steered_nums_++;
+          continue;
+        }
+
+        neighbour_nodes.clear();
+        struct kdres *nbr_set = kd_nearest_range3(kd_tree_, x_new[0], x_new[1], x_new[2], search_radius_);
+        if (nbr_set == nullptr)
+        {
+          ROS_ERROR("bkwd kd range query error");
+          break;
+        }
+        while (!kd_res_end(nbr_set))
+        {
+          neighbour_nodes.push_back(kdDataToNodeId(kd_res_item_data(nbr_set)));
+          kd_res_next(nbr_set);
+        }
+        kd_res_free(nbr_set);
+
+        // a snapshot misses the nodes inserted since, the candidate may land on one of them, e.g.
+        // on the node at the goal when the goal was sampled twice
+        bool duplicate = false;
+        for (const NodeId &curr_node : neighbour_nodes)
+          duplicate = duplicate || calDist(tree_.x[curr_node], x_new) < 1e-9;
+        if (duplicate)
+          continue;
+
+        /* 1. choose parent, the nearest node of the snapshot is the default one */
+        NodeId min_node = candidate.nearest_node;
+        double cost_from_p = calDist(tree_.x[min_node], x_new);
+        double min_dist_from_start = costFromStart(min_node) + cost_from_p;
+        for (const NodeId &curr_node : neighbour_nodes)
+        {
+          double dist2current = calDist(tree_.x[curr_node], x_new);
+          double current_dist_from_start = costFromStart(curr_node) + dist2current;
+          if (current_dist_from_start < min_dist_from_start)
+          {
+            int valid = snapshotEdges(candidate, curr_node).to_new;
+            if (valid < 0)
+              valid = map_ptr_->isSegmentValid(tree_.x[curr_node], x_new, DBL_MAX, &seg_check_stats_);
+            if (valid)
+            {
+              min_node = curr_node;
+              cost_from_p = dist2current;
+              min_dist_from_start = current_dist_from_start;
+            }
+          }
+        }
+
+        NodeId new_node = addTreeNode(min_node, x_new, min_dist_from_start, cost_from_p);
+        kd_insert3(kd_tree_, x_new[0], x_new[1], x_new[2], nodeIdToKdData(new_node));
+        kd_node_nums_++;
+        for (int t = 0; t < pipeline_producers_; ++t)
+          node_queues[t]->push({new_node, x_new, min_dist_from_start});
+
+        /* 2. try to connect to goal if possible */
+        double dist_to_goal = calDist(x_new, goal_x);
+        if (dist_to_goal <= search_radius_ && costFromStart(goal_node_) > dist_to_goal + costFromStart(new_node) &&
+            map_ptr_->isSegmentValid(x_new, goal_x, DBL_MAX, &seg_check_stats_))
+        {
+          if (!goal_found)
+            first_path_use_time_ = (ros::Time::now() - rrt_start_time).toSec();
+          goal_found = true;
+          changeNodeParent(goal_node_, new_node, dist_to_goal);
+          storeSolution(rrt_start_time, c_square, idx);
+        }
+
+        /* 3. rewire */
+        ros::WallTime rewire_start_time = ros::WallTime::now();
+        for (const NodeId &curr_node : neighbour_nodes)
+        {
+          double best_cost_before_rewire = costFromStart(goal_node_);
+          double dist_to_child = calDist(tree_.x[new_node], tree_.x[curr_node]);
+          double current_dist_from_new = costFromStart(new_node) + dist_to_child;
+          double promising_cost = current_dist_from_new + calDist(tree_.x[curr_node], goal_x);
+          if (current_dist_from_new >= costFromStart(curr_node) || promising_cost >= best_cost_before_rewire)
+            continue;
+          int valid = snapshotEdges(candidate, curr_node).from_new;
+          if (valid < 0)
+            valid = map_ptr_->isSegmentValid(tree_.x[new_node], tree_.x[curr_node], DBL_MAX, &seg_check_stats_);
+          if (valid)
+          {
+            changeNodeParent(curr_node, new_node, dist_to_child);
+            if (best_cost_before_rewire > costFromStart(goal_node_))
+              storeSolution(rrt_start_time, c_square, idx);
+          }
+        }
+        rewire_time_ += (ros::WallTime::now() - rewire_start_time).toSec();
+
+        snapshot_neighbours += candidate.neighbours.size();
+        missing_neighbours += neighbour_nodes.size() - std::min(neighbour_nodes.size(), candidate.neighbours.size());
+      }
+      /* end of sample once */
+
+      stop = true;
+      for (std::thread &producer : producers)
+        producer.join();
+
+      env::SegmentCheckStats owner_stats = seg_check_stats_;
+      for (int t = 0; t < pipeline_producers_; ++t)
+        seg_check_stats_.add(producer_stats[t]);
+      double search_use_time = (ros::Time::now() - rrt_start_time).toSec();
+      ROS_INFO_STREAM("[RRT*]: pipeline: " << pipeline_producers_ << " producers, " << idx << " candidates ("
+                      << idx / search_use_time << " /s), planning thread idle " << idle_nums << " times, segment checks: "
+                      << owner_stats.segments << " on the planning thread, " << seg_check_stats_.segments - owner_stats.segments
+                      << " on the producers, neighbours missing from the snapshots: " << missing_neighbours << " of "
+                      << snapshot_neighbours + missing_neighbours);
+
+      goal_found_ = goal_found;
+      return summarizeSearch(rrt_start_time, goal_found);
+    }
+
+    // the edges a producer checked between x_new and node, none if node is newer than its snapshot
+    PipelineEdges snapshotEdges(const PipelineCandidate &candidate, NodeId node)
+    {
+      PipelineEdges edges = {node, -1, -1};
+      vector<PipelineEdges>::const_iterator it = std::lower_bound(candidate.neighbours.begin(), candidate.neighbours.end(), edges);
+      return it != candidate.neighbours.end() && it->node == node ? *it : edges;
+    }
+
+    void pipelineProducer(BiasSampler sampler, const vector<PipelineNode> &initial_nodes, double c_square,
+                          SPSCQueue<PipelineNode> &nodes_in, SPSCQueue<PipelineCandidate> &candidates_out,
+                          std::atomic<bool> &stop, env::SegmentCheckStats &seg_check_stats)
+    {
+      // the snapshot: a kd-tree of the nodes received so far, their states and costs by id
+      kdtree *snapshot = kd_create(3);
+      vector<Eigen::Vector3d> snapshot_x(tree_.size());
+      vector<double> snapshot_cost(tree_.size());
+      for (const PipelineNode &node : initial_nodes)
+      {
+        kd_insert3(snapshot, node.x[0], node.x[1], node.x[2], nodeIdToKdData(node.node));
+        snapshot_x[node.node] = node.x;
+        snapshot_cost[node.node] = node.cost_from_start;
+      }
+      const Eigen::Vector3d start_x = tree_.x[start_node_];
+      const Eigen::Vector3d goal_x = tree_.x[goal_node_];
+      double informed_cost = DBL_MAX;
+      vector<std::pair<double, NodeId>> parent_order;
+      PipelineCandidate candidate;
+      bool pending = false;
+
+      while (!stop)
+      {
+        PipelineNode node;
+        while (nodes_in.pop(node))
+        {
+          kd_insert3(snapshot, node.x[0], node.x[1], node.x[2], nodeIdToKdData(node.node));
+          snapshot_x[node.node] = node.x;
+          snapshot_cost[node.node] = node.cost_from_start;
+        }
+
+        // a full queue means the planning thread is busy, retry the candidate we already have
+        if (pending)
+        {
+          if (candidates_out.push(std::move(candidate)))
+            pending = false;
+          else
+            std::this_thread::yield();
+          continue;
+        }
+
+        // the informed set follows the best cost, the bias path stays with the planning thread
+        double best_cost = best_cost_;
+        if (best_cost < DBL_MAX)
+          sampler.setGoalReached();
+        if (use_informed_sampling_ && best_cost < informed_cost)
+        {
+          informed_cost = best_cost;
+          sampler.setInformedSacling(informedScale(best_cost, c_square));
+        }
+
+        Eigen::Vector3d x_rand;
+        sampler.samplingOnce(x_rand);
+        if (use_sample_rejection_ && calDist(start_x, x_rand) + calDist(x_rand, goal_x) >= best_cost)
+          continue;
+        if (!map_ptr_->isStateValid(x_rand))
+          continue;
+
+        struct kdres *p_nearest = kd_nearest3(snapshot, x_rand[0], x_rand[1], x_rand[2]);
+        if (p_nearest == nullptr)
+        {
+          ROS_ERROR("nearest query error");
+          continue;
+        }
+        NodeId nearest_node = kdDataToNodeId(kd_res_item_data(p_nearest));
+        kd_res_free(p_nearest);
+        candidate.nearest_node = nearest_node;
+        candidate.x_new = steer(snapshot_x[nearest_node], x_rand, steer_length_);
+        const Eigen::Vector3d &x_new = candidate.x_new;
+        if (use_sample_rejection_ && calDist(start_x, x_new) + calDist(x_new, goal_x) >= best_cost)
+          continue;
+        if (!map_ptr_->isSegmentValid(snapshot_x[nearest_node], x_new, DBL_MAX, &seg_check_stats))
+          continue;
+
+        struct kdres *nbr_set = kd_nearest_range3(snapshot, x_new[0], x_new[1], x_new[2], search_radius_);
+        if (nbr_set == nullptr)
+        {
+          ROS_ERROR("bkwd kd range query error");
+          continue;
+        }
+        parent_order.clear();
+        while (!kd_res_end(nbr_set))
+        {
+          NodeId curr_node = kdDataToNodeId(kd_res_item_data(nbr_set));
+          parent_order.emplace_back(snapshot_cost[curr_node] + calDist(snapshot_x[curr_node], x_new), curr_node);
+          kd_res_next(nbr_set);
+        }
+        kd_res_free(nbr_set);
+
+        // the same checks as rrt_star() with the snapshot costs: the parent edges in order of cost
+        // up to the first valid one, then the rewire edges of the neighbours x_new would improve
+        std::sort(parent_order.begin(), parent_order.end());
+        double new_cost = snapshot_cost[nearest_node] + calDist(snapshot_x[nearest_node], x_new);
+        bool parent_found = false;
+        candidate.neighbours.clear();
+        for (const std::pair<double, NodeId> &neighbour : parent_order)
+        {
+          NodeId curr_node = neighbour.second;
+          PipelineEdges edges = {curr_node, -1, -1};
+          if (curr_node == nearest_node)
+          {
+            edges.to_new = 1;
+          }
+          else if (!parent_found && neighbour.first < new_cost)
+          {
+            edges.to_new = map_ptr_->isSegmentValid(snapshot_x[curr_node], x_new, DBL_MAX, &seg_check_stats);
+            if (edges.to_new)
+            {
+              new_cost = neighbour.first;
+              parent_found = true;
+            }
+          }
+          candidate.neighbours.push_back(edges);
+        }
+        for (PipelineEdges &edges : candidate.neighbours)
+        {
+          double dist_to_child = calDist(x_new, snapshot_x[edges.node]);
+          if (new_cost + dist_to_child < snapshot_cost[edges.node] &&
+              new_cost + dist_to_child + calDist(snapshot_x[edges.node], goal_x) < best_cost)
+            edges.from_new = map_ptr_->isSegmentValid(x_new, snapshot_x[edges.node], DBL_MAX, &seg_check_stats);
+        }
+        std::sort(candidate.neighbours.begin(), candidate.neighbours.end());
+        pending = !candidates_out.push(std::move(candidate));
+      }
+      kd_free(snapshot);
+    }
+
+    // keep the tree of the last query and re-root it at s, false if it can not be reused
+    bool warmStart(const Eigen::Vector3d &s, const Eigen::Vector3d &g)
+    {
+      if (valid_tree_node_nums_ == 0)
+        return false;
+
+      // the new root is the old goal (the usual chained query) or the tree node nearest to s
+      NodeId root = NULL_NODE;
+      bool goal_connected = tree_.parent[goal_node_] != NULL_NODE;
+      if (goal_connected && calDist(tree_.x[goal_node_], s) < 1e-6)
+      {
+        root = goal_node_;
+      }
+      else
+      {
+        struct kdres *p_nearest = kd_nearest3(kd_tree_, s[0], s[1], s[2]);
+        if (p_nearest == nullptr)
+          return false;
+        NodeId nearest_node = kdDataToNodeId(kd_res_item_data(p_nearest));
+        kd_res_free(p_nearest);
+        if (calDist(tree_.x[nearest_node], s) < 1e-6)
+          root = nearest_node;
+        else if (valid_tree_node_nums_ < max_tree_node_nums_ && map_ptr_->isSegmentValid(s, tree_.x[nearest_node], DBL_MAX, &seg_check_stats_))
+        {
+          root = addTreeNode(nearest_node, s, DBL_MAX, calDist(tree_.x[nearest_node], s));
+          kd_insert3(kd_tree_, s[0], s[1], s[2], nodeIdToKdData(root));
+          kd_node_nums_++;
+        }
+        else
+          return false;
+      }
+
+      // the old goal is not in the kd-tree and has no children, drop it unless it is the new root
+      if (root == goal_node_)
+      {
+        kd_insert3(kd_tree_, s[0], s[1], s[2], nodeIdToKdData(root));
+        kd_node_nums_++;
+      }
+      else
+      {
+        tree_.unlink(goal_node_);
+        tree_.clearNode(goal_node_);
+        free_nodes_.push_back(goal_node_);
+        valid_tree_node_nums_--;
+      }
+
+      // the edges from the new root up to the old one are about to be reversed and a segment check is
+      // not symmetric, so they are checked again in their new direction. The first blocked one cuts the
+      // tree: the new root keeps its side, the old root's side is dropped.
+      NodeId cut = NULL_NODE;
+      for (NodeId n = root; tree_.parent[n] != NULL_NODE && cut == NULL_NODE; n = tree_.parent[n])
+      {
+        if (!map_ptr_->isSegmentValid(tree_.x[n], tree_.x[tree_.parent[n]], DBL_MAX, &seg_check_stats_))
+          cut = n;
+      }
+      if (cut != NULL_NODE)
+      {
+        NodeId old_root = cut;
+        while (tree_.parent[old_root] != NULL_NODE)
+          old_root = tree_.parent[old_root];
+        tree_.unlink(cut);
+        removeSubtree(old_root);
+      }
+
+      // reverse the edges from the new root up to the old one
+      NodeId prev = NULL_NODE, node = root;
+      double prev_cost_from_parent = 0.0;
+      while (node != NULL_NODE)
+      {
+        NodeId next = tree_.parent[node];
+        double cost_from_parent = tree_.cost_from_parent[node];
+        tree_.unlink(node);
+        if (prev != NULL_NODE)
+        {
+          tree_.link(node, prev);
+          tree_.cost_from_parent[node] = prev_cost_from_parent;
+        }
+        prev_cost_from_parent = cost_from_parent;
+        prev = node;
+        node = next;
+      }
+      start_node_ = root;
+      tree_.cost_from_parent[root] = 0.0;
+      if (cut != NULL_NODE)
+        rebuildKdTree();
+
+      // recompute every cost from the new root, under a new version
+      cost_epoch_++;
+      tree_.cost_from_start[root] = 0.0;
+      tree_.cost_stamp[root] = cost_epoch_;
+      tree_.cost_checked[root] = cost_epoch_;
+      descendant_stack_.clear();
+      descendant_stack_.push_back(root);
+      while (!descendant_stack_.empty())
+      {
+        NodeId n = descendant_stack_.back();
+        descendant_stack_.pop_back();
+        for (NodeId child = tree_.first_child[n]; child != NULL_NODE; child = tree_.next_sibling[child])
+        {
+          tree_.cost_from_start[child] = tree_.cost_from_start[n] + tree_.cost_from_parent[child];
+          tree_.cost_stamp[child] = cost_epoch_;
+          tree_.cost_checked[child] = cost_epoch_;
+          descendant_stack_.push_back(child);
+        }
+      }
+
+      // room for the goal and for growing, a full tree gives up the leaves least useful for g
+      if (valid_tree_node_nums_ >= max_tree_node_nums_ - 1)
+        evictLeaves(std::max(2, (int)(EVICT_RATIO * max_tree_node_nums_)), g);
+      goal_node_ = allocNode();
+      tree_.clearNode(goal_node_);
+      tree_.x[goal_node_] = g;
+      tree_.cost_from_start[goal_node_] = DBL_MAX;
+
+      ROS_INFO_STREAM("[RRT*]: warm start from " << valid_tree_node_nums_ << " nodes");
+      return true;
+    }
+
+    // connect the goal to the best tree node within search_radius_, used after a warm start
+    bool connectGoalToTree()
+    {
+      const Eigen::Vector3d &goal_x = tree_.x[goal_node_];
+      struct kdres *nbr_set = kd_nearest_range3(kd_tree_, goal_x[0], goal_x[1], goal_x[2], search_radius_);
+      if (nbr_set == nullptr)
+        return false;
+      vector<std::pair<double, NodeId>> candidates;
+      while (!kd_res_end(nbr_set))
+      {
+        NodeId curr_node = kdDataToNodeId(kd_res_item_data(nbr_set));
+        candidates.emplace_back(costFromStart(curr_node) + calDist(tree_.x[curr_node], goal_x), curr_node);
+        kd_res_next(nbr_set);
+      }
+      kd_res_free(nbr_set);
+
+      // the first valid edge in increasing cost is the best parent
+      std::sort(candidates.begin(), candidates.end());
+      for (const auto &candidate : candidates)
+      {
+        if (map_ptr_->isSegmentValid(tree_.x[candidate.second], goal_x, DBL_MAX, &seg_check_stats_))
+        {
+          changeNodeParent(goal_node_, candidate.second, candidate.first - costFromStart(candidate.second));
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // store the path and cost of the current solution and shrink the informed set to it
+    // visualize: publish the shrunk informed set now, the parallel workers publish it after
+    // releasing the tree lock instead
+    void storeSolution(const ros::Time &rrt_start_time, double c_square, int iteration, bool visualize = true)
+    {
+      vector<Eigen::Vector3d> curr_best_path;
+      fillPath(goal_node_, curr_best_path);
+      sampler_.setBiasPath(curr_best_path);
+      path_list_.emplace_back(std::move(curr_best_path));
+      sampler_.setGoalReached();
+
+      // store the cost and the total time to now
+      solution_cost_time_pair_list_.emplace_back(costFromStart(goal_node_), (ros::Time::now() - rrt_start_time).toSec());
+      solution_iteration_list_.push_back(iteration);
+      best_cost_ = costFromStart(goal_node_);
+      solution_version_++;
+
+      if (shared_best_cost_)
+      {
+        double shared_cost = *shared_best_cost_;
+        while (best_cost_ < shared_cost && !shared_best_cost_->compare_exchange_weak(shared_cost, best_cost_))
+          ;
+      }
+
+      // ----------informed RRT*
+      if (use_informed_sampling_ && !multi_goal_ && costFromStart(goal_node_) < informed_cost_)
+      {
+        shrinkInformedSet(costFromStart(goal_node_), c_square, visualize);
+      }
+    }
+
+    // whether a path reaching x at cost_to_x may still improve the path to some goal, with the
+    // Euclidean distance as the heuristic
+    bool mayImproveGoal(const Eigen::Vector3d &x, double cost_to_x)
+    {
+      for (const NodeId &goal : goal_nodes_)
+      {
+        if (cost_to_x + calDist(x, tree_.x[goal]) < costFromStart(goal))
+          return true;
+      }
+      return false;
+    }
+
+    // with several goals: take the new costs of the goals after a connection or a rewire. The
+    // cheapest goal is the solution of the query, and once every goal is reached the samples are
+    // drawn from the union of the informed sets of the goals, before that some set is unbounded.
+    void updateGoalSolutions(int iteration)
+    {
+      bool improved = false;
+      size_t best = 0;
+      for (size_t k = 0; k < goal_nodes_.size(); ++k)
+      {
+        double cost = costFromStart(goal_nodes_[k]);
+        if (cost < goal_costs_[k])
+        {
+          if (goal_costs_[k] == DBL_MAX)
+            ROS_INFO_STREAM("[RRT*]: goal " << k << " reached after " << (ros::Time::now() - rrt_start_time_).toSec() << " s, cost: " << cost);
+          goal_costs_[k] = cost;
+          improved = true;
+        }
+        if (goal_costs_[k] < goal_costs_[best])
+          best = k;
+      }
+      if (!improved)
+        return;
+
+      if (goal_costs_[best] < best_cost_)
+      {
+        goal_node_ = goal_nodes_[best];
+        storeSolution(rrt_start_time_, c_square_, iteration);
+      }
+
+      // the goal bias follows the goals not reached yet
+      std::vector<double>::iterator unsolved = std::find(goal_costs_.begin(), goal_costs_.end(), DBL_MAX);
+      if (unsolved != goal_costs_.end())
+      {
+        sampler_.setGoal(tree_.x[goal_nodes_[unsolved - goal_costs_.begin()]]);
+        return;
+      }
+      sampler_.setGoalReached();
+      if (!use_informed_sampling_)
+        return;
+      vector<BiasSampler::InformedSet> sets(goal_nodes_.size());
+      for (size_t k = 0; k < goal_nodes_.size(); ++k)
+        calInformedSet(goal_costs_[k], tree_.x[start_node_], tree_.x[goal_nodes_[k]], sets[k].radii, sets[k].center, sets[k].rotation);
+      sampler_.setInformedUnion(sets);
+    }
+
+    void shrinkInformedSet(double cost, double c_square, bool visualize = true)
+    {
+      informed_cost_ = cost;
+      scale_ = informedScale(cost, c_square);
+      sampler_.setInformedSacling(scale_); // set true and the scale begin informed rrt*
+      if (visualize)
+        visualizeInformedSet(scale_);
+    }
+
+    void visualizeInformedSet(const Eigen::Vector3d &scale)
+    {
+      if (vis_ptr_)
+      {
+        std::vector<visualization::ELLIPSOID> ellps;
+        ellps.emplace_back(trans_, scale, rot_);
+        vis_ptr_->visualize_ellipsoids(ellps, "informed_set", visualization::yellow, 0.2);
+      }
+    }
+
+    // remove every subtree that cannot improve the current solution: g(n) + h(n) >= c_best holds
+    // for all the descendants once it holds for n, so whole subtrees are cut from the tree,
+    // their slots go to free_nodes_ and the kd-tree is rebuilt from the remaining nodes
+    // informed pruning, periodically after the solution improved or whenever the tree is full
+    bool pruneDue()
+    {
+      if (!use_tree_pruning_ || !goal_found_ || multi_goal_)
+        return false;
+      bool tree_full = valid_tree_node_nums_ >= max_tree_node_nums_;
+      bool improved = costFromStart(goal_node_) < last_prune_cost_ && iteration_ - last_prune_idx_ >= prune_interval_;
+      return tree_full || improved;
+    }
+
+    bool evictDue() const
+    {
+      return anytime_mode_ && !multi_goal_ && valid_tree_node_nums_ >= max_tree_node_nums_;
+    }
+
+    // the due maintenance passes, timed so that iterate() can tell whether the next one fits
+    void maintainTree()
+    {
+      if (pruneDue())
+      {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        int node_nums = valid_tree_node_nums_;
+        pruneTree();
+        last_prune_idx_ = iteration_;
+        last_prune_cost_ = costFromStart(goal_node_);
+        prune_us_per_node_ = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / node_nums;
+      }
+      if (evictDue())
+      {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        int node_nums = valid_tree_node_nums_;
+        evictLeaves(std::max(1, (int)(EVICT_RATIO * max_tree_node_nums_)), tree_.x[goal_node_]);
+        evict_us_per_node_ = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / node_nums;
+      }
+    }
+
+    void pruneTree()
+    {
+      const Eigen::Vector3d &goal_x = tree_.x[goal_node_];
+      double best_cost = costFromStart(goal_node_);
+      for (NodeId n = goal_node_; n != NULL_NODE; n = tree_.parent[n])
+        prune_keep_[n] = 1;
+
+      // top-down pass, the lazy costs are refreshed on the way
+      vector<NodeId> prune_roots;
+      descendant_stack_.clear();
+      descendant_stack_.push_back(start_node_);
+      while (!descendant_stack_.empty())
+      {
+        NodeId node = descendant_stack_.back();
+        descendant_stack_.pop_back();
+        for (NodeId child = tree_.first_child[node]; child != NULL_NODE; child = tree_.next_sibling[child])
+        {
+          if (lazy_cost_propagation_)
+          {
+            tree_.cost_from_start[child] = tree_.cost_from_start[node] + tree_.cost_from_parent[child];
+            tree_.cost_stamp[child] = std::max(tree_.cost_stamp[child], tree_.cost_stamp[node]);
+            tree_.cost_checked[child] = cost_epoch_;
+          }
+          if (!prune_keep_[child] && tree_.cost_from_start[child] + calDist(tree_.x[child], goal_x) >= best_cost)
+            prune_roots.push_back(child);
+          else
+            descendant_stack_.push_back(child);
+        }
+      }
+      for (NodeId n = goal_node_; n != NULL_NODE; n = tree_.parent[n])
+        prune_keep_[n] = 0;
+
+      for (const NodeId &root : prune_roots)
+        pruned_node_nums_ += removeSubtree(root);
+      prune_nums_++;
+      if (!prune_roots.empty())
+        rebuildKdTree();
+    }
+
+    // cut the subtree of root from the tree and recycle its slots, the kd-tree is left to the caller
+    int removeSubtree(NodeId root)
+    {
+      int removed = 0;
+      tree_.unlink(root);
+      descendant_stack_.clear();
+      descendant_stack_.push_back(root);
+      while (!descendant_stack_.empty())
+      {
+        NodeId node = descendant_stack_.back();
+        descendant_stack_.pop_back();
+        for (NodeId child = tree_.first_child[node]; child != NULL_NODE; child = tree_.next_sibling[child])
+          descendant_stack_.push_back(child);
+        tree_.clearNode(node);
+        free_nodes_.push_back(node);
+        removed++;
+      }
+      valid_tree_node_nums_ -= removed;
+      return removed;
+    }
+
+    // evict the num leaves with the worst g(n) + h(n), used when the tree is full in anytime mode
+    void evictLeaves(int num, const Eigen::Vector3d &goal_x)
+    {
+      vector<std::pair<double, NodeId>> leaves;
+      for (int i = 0; i < tree_node_end_; ++i)
+      {
+        if (tree_.parent[i] == NULL_NODE || tree_.first_child[i] != NULL_NODE || (NodeId)i == goal_node_)
+          continue;
+        leaves.emplace_back(costFromStart(i) + calDist(tree_.x[i], goal_x), i);
+      }
+      num = std::min(num, (int)leaves.size());
+      if (num == 0)
+        return;
+      std::nth_element(leaves.begin(), leaves.begin() + num - 1, leaves.end(), std::greater<std::pair<double, NodeId>>());
+      for (int i = 0; i < num; ++i)
+      {
+        NodeId node = leaves[i].second;
+        tree_.unlink(node);
+        tree_.clearNode(node);
+        free_nodes_.push_back(node);
+      }
+      valid_tree_node_nums_ -= num;
+      evicted_node_nums_ += num;
+      rebuildKdTree();
+    }
+
+    // the kd-tree can not delete, rebuild it from the nodes left
+    void rebuildKdTree()
+    {
+      kd_clear(kd_tree_);
+      kd_node_nums_ = 0;
+      for (int i = 0; i < tree_node_end_; ++i)
+      {
+        if ((NodeId)i == start_node_ || (tree_.parent[i] != NULL_NODE && (NodeId)i != goal_node_))
+        {
+          kd_insert3(kd_tree_, tree_.x[i][0], tree_.x[i][1], tree_.x[i][2], nodeIdToKdData(i));
+          kd_node_nums_++;
+        }
+      }
+    }
+
+    // bytes held by the tree arrays and the kd-tree, the arrays are allocated once for max_tree_node_nums_
+    size_t memoryUsage()
+    {
+      size_t node_bytes = sizeof(Eigen::Vector3d) + 2 * sizeof(double) + 2 * sizeof(uint32_t) + 4 * sizeof(NodeId);
+      // a kd-tree node holds its position array, dir, data and two children
+      size_t kd_node_bytes = 3 * sizeof(double) + sizeof(int) + 4 * sizeof(void *);
+      return tree_.size() * node_bytes + kd_node_nums_ * kd_node_bytes;
+    }
+
+    // vertice store the coordinate of all points
+    // edges store the coordinate corresponding to two points
+    void sampleWholeTree(vector<Eigen::Vector3d> &vertice, vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> &edges)
+    {
+      // every node with a parent is connected to the start, a linear scan over the arrays is enough
+      for (int i = 0; i < tree_node_end_; ++i)
+      {
+        NodeId parent = tree_.parent[i];
+        if (parent == NULL_NODE)
+          continue;
+        vertice.push_back(tree_.x[i]);
+        edges.emplace_back(std::make_pair(tree_.x[parent], tree_.x[i]));
+      }
+    }
+
+    // check_edges_ on the pool, the result of each edge goes to edge_valid_ of its neighbour
+    void checkEdgesInParallel()
+    {
+      check_valid_.resize(check_edges_.size());
+      check_pool_->parallelFor(check_edges_.size(), [this](int i, int thread) {
+        check_valid_[i] = map_ptr_->isSegmentValid(check_edges_[i].first, check_edges_[i].second, DBL_MAX, &check_stats_[thread]);
+      });
+      for (size_t i = 0; i < check_edges_.size(); ++i)
+        edge_valid_[check_index_[i]] = check_valid_[i];
+      for (env::SegmentCheckStats &stats : check_stats_)
+      {
+        seg_check_stats_.add(stats);
+        stats.reset();
+      }
+      parallel_check_nums_ += check_edges_.size();
+    }
+
+    // radii of the prolate spheroid of the states that may lie on a path cheaper than cost
+    static Eigen::Vector3d informedScale(double cost, double c_square)
+    {
+      Eigen::Vector3d scale;
+      scale[0] = cost / 2.0;
+      scale[1] = sqrt(scale[0] * scale[0] - c_square);
+      scale[2] = scale[1];
+      return scale;
     }
   };
 
@@ -21,9 +21,51 @@ OF SUCH DAMAGE.
 #ifndef _BIAS_SAMPLER_
 #define _BIAS_SAMPLER_
 
+#include "occ_grid/occ_map.h"
 #include <ros/ros.h>
 #include <Eigen/Eigen>
 #include <random>
+#include <vector>
+#include <algorithm>
+
+// xoshiro256+, only the top 53 bits are used so its weak low bits do not matter
+class Xoshiro256p
+{
+public:
+  void seed(uint64_t seed)
+  {
+    // splitmix64 to spread the seed over the state
+    for (int i = 0; i < 4; ++i)
+    {
+      uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      s_[i] = z ^ (z >> 31);
+    }
+  }
+
+  uint64_t next()
+  {
+    uint64_t result = s_[0] + s_[3];
+    uint64_t t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = (s_[3] << 45) | (s_[3] >> 19);
+    return result;
+  }
+
+  // (0.0, 1.0]
+  double nextDouble()
+  {
+    return (int64_t)((next() >> 11) + 1) * (1.0 / 9007199254740992.0);
+  }
+
+private:
+  uint64_t s_[4];
+};
 
 class BiasSampler
 {
@@ -37,6 +79,40 @@ public:
     range_.setZero();
     origin_.setZero();
     informed_ = false;
+    informed_from_box_ = false;
+    informed_tries_ = 0;
+    informed_accepts_ = 0;
+    goal_bias_ = 0.0;
+    goal_reached_ = false;
+    path_bias_ = 0.0;
+    path_sigma_ = 1.0;
+    bridge_ratio_ = 0.0;
+    gaussian_ratio_ = 0.0;
+    obstacle_sigma_ = 1.0;
+    sequence_type_ = RANDOM;
+    seq_idx_ = 0;
+    initSobol();
+    batch_sampling_ = false;
+    xoshiro_.seed(gen_());
+    cube_batch_.resize(3, BATCH_SIZE);
+    ball_batch_.resize(3, BATCH_SIZE);
+    cube_pos_ = ball_pos_ = BATCH_SIZE;
+  };
+
+  // the points of the unit cube behind uniform and informed sampling
+  enum SequenceType
+  {
+    RANDOM = 0,
+    HALTON = 1,
+    SOBOL = 2,
+    SCRAMBLED_SOBOL = 3
+  };
+
+  // an ellipsoid in the frame of its principal axes
+  struct InformedSet
+  {
+    Eigen::Vector3d center, radii;
+    Eigen::Matrix3d rotation;
   };
 
   void setSamplingRange(const Eigen::Vector3d origin, const Eigen::Vector3d range)
@@ -45,37 +121,66 @@ public:
     range_ = range;
   }
 
+  // the goal with probability goal_bias_ until it is reached, around the best path with
+  // probability path_bias_ once there is one, otherwise informed or uniform sampling
   void samplingOnce(Eigen::Vector3d &sample)
   {
-    if (informed_)
+    double goal_bias = goal_reached_ ? 0.0 : goal_bias_;
+    if (goal_bias > 0.0 || !bias_path_.empty())
+    {
+      double u = uniform_rand_(gen_);
+      if (u < goal_bias)
+      {
+        sample = goal_;
+        return;
+      }
+      if (!bias_path_.empty() && u < goal_bias + path_bias_)
+      {
+        pathSamplingOnce(sample);
+        return;
+      }
+    }
+
+    if (occ_map_)
+    {
+      double u = uniform_rand_(gen_);
+      if (u < bridge_ratio_ && bridgeSamplingOnce(sample))
+        return;
+      if (u >= bridge_ratio_ && u < bridge_ratio_ + gaussian_ratio_ && gaussianSamplingOnce(sample))
+        return;
+    }
+
+    if (!informed_union_.empty())
+    {
+      unionInformedSamplingOnce(sample);
+    }
+    else if (informed_)
     {
-      informedSamplingOnce(sample);
+      if (!free_ranges_.empty())
+        freeInformedSamplingOnce(sample);
+      else
+        boundedInformedSamplingOnce(sample);
     }
     else
     {
-      uniformSamplingOnce(sample);
+      if (free_map_ && free_map_->freeVoxelNum() > 0)
+        freeSamplingOnce(sample);
+      else
+        uniformSamplingOnce(sample);
     }
   };
 
   void uniformSamplingOnce(Eigen::Vector3d &sample)
   {
-    sample[0] = uniform_rand_(gen_);
-    sample[1] = uniform_rand_(gen_);
-    sample[2] = uniform_rand_(gen_);
-    
+    unitCubeOnce(sample);
+
     sample.array() *= range_.array();
     sample += origin_;
   };
 
   void informedSamplingOnce(Eigen::Vector3d &sample)
   {
-    // random uniform sampling in a unit 3-ball
-    Eigen::Vector3d p;
-    p[0] = normal_rand_(gen_);
-    p[1] = normal_rand_(gen_);
-    p[2] = normal_rand_(gen_);
-    double r = pow(uniform_rand_(gen_), 0.33333);
-    sample = r * p.normalized();
+    unitBallOnce(sample);
 
     // transform the pt into the ellipsoid
     sample.array() *= radii_.array();  //radii a b c
@@ -83,9 +188,350 @@ public:
     sample += center_;
   };
 
+  // uniform in the union of informed_union_ intersected with the map box: an ellipsoid is picked
+  // in proportion to its volume and a point in it is kept with the inverse of the number of
+  // ellipsoids holding it, so the overlaps are not sampled more densely
+  void unionInformedSamplingOnce(Eigen::Vector3d &sample)
+  {
+    const int max_tries = 1000;
+    for (int i = 0; i < max_tries; ++i)
+    {
+      double v = uniform_rand_(gen_) * union_volume_.back();
+      size_t k = std::upper_bound(union_volume_.begin(), union_volume_.end(), v) - union_volume_.begin() - 1;
+      k = std::min(k, informed_union_.size() - 1);
+      const InformedSet &set = informed_union_[k];
+      unitBallOnce(sample);
+      sample = set.rotation * sample.cwiseProduct(set.radii) + set.center;
+      informed_tries_++;
+      if ((sample.array() < origin_.array()).any() || (sample.array() > (origin_ + range_).array()).any())
+        continue;
+      int holders = 0;
+      for (const InformedSet &other : informed_union_)
+        holders += (other.rotation.transpose() * (sample - other.center)).cwiseQuotient(other.radii).squaredNorm() <= 1.0;
+      if (holders <= 1 || uniform_rand_(gen_) * holders < 1.0)
+      {
+        informed_accepts_++;
+        return;
+      }
+    }
+    // the union barely overlaps the map, a draw from the whole map stays valid
+    uniformSamplingOnce(sample);
+  }
+
+  // a point of the segment between the foci of an ellipsoid, which lies inside it and, as the foci
+  // are the start and a goal, inside the map. The fallback when rejection sampling keeps failing.
+  void focalSegmentOnce(const Eigen::Vector3d &center, const Eigen::Matrix3d &rotation, const Eigen::Vector3d &radii,
+                        Eigen::Vector3d &sample)
+  {
+    double c = sqrt(std::max(0.0, radii[0] * radii[0] - radii[1] * radii[1]));
+    sample = center + rotation.col(0) * (c * (2.0 * uniform_rand_(gen_) - 1.0));
+  }
+
+  // uniform in the unit 3-ball
+  void unitBallOnce(Eigen::Vector3d &sample)
+  {
+    // random uniform sampling in a unit 3-ball
+    if (sequence_type_ == RANDOM && batch_sampling_)
+    {
+      if (ball_pos_ == BATCH_SIZE)
+        refillBallBatch();
+      sample = ball_batch_.col(ball_pos_++);
+    }
+    else if (sequence_type_ == RANDOM)
+    {
+      Eigen::Vector3d p;
+      p[0] = normal_rand_(gen_);
+      p[1] = normal_rand_(gen_);
+      p[2] = normal_rand_(gen_);
+      double r = pow(uniform_rand_(gen_), 0.33333);
+      sample = r * p.normalized();
+    }
+    else
+    {
+      // volume preserving map of the unit cube onto the unit ball, keeps the low discrepancy
+      Eigen::Vector3d u;
+      unitCubeOnce(u);
+      double r = cbrt(u[0]);
+      double z = 1.0 - 2.0 * u[1];
+      double rho = sqrt(std::max(0.0, 1.0 - z * z));
+      double phi = 2.0 * M_PI * u[2];
+      sample = r * Eigen::Vector3d(rho * cos(phi), rho * sin(phi), z);
+    }
+  }
+
+  // the region sampled by the obstacle based samplers, the whole map or the informed set
+  void regionSamplingOnce(Eigen::Vector3d &sample)
+  {
+    if (!informed_union_.empty())
+      unionInformedSamplingOnce(sample);
+    else if (informed_)
+      boundedInformedSamplingOnce(sample);
+    else
+      uniformSamplingOnce(sample);
+  }
+
+  // bridge test: the midpoint of two occupied points close to each other, if it is free it most
+  // likely lies in a narrow passage
+  bool bridgeSamplingOnce(Eigen::Vector3d &sample)
+  {
+    const int max_tries = 20;
+    Eigen::Vector3d x1, x2;
+    for (int i = 0; i < max_tries; ++i)
+    {
+      regionSamplingOnce(x1);
+      if (occ_map_->isStateValid(x1))
+        continue;
+      x2 = x1 + obstacle_sigma_ * Eigen::Vector3d(normal_rand_(gen_), normal_rand_(gen_), normal_rand_(gen_));
+      if (occ_map_->isStateValid(x2))
+        continue;
+      sample = 0.5 * (x1 + x2);
+      if (occ_map_->isStateValid(sample))
+        return true;
+    }
+    return false;
+  }
+
+  // gaussian obstacle based sampling: of two points close to each other keep the free one if the
+  // other is occupied, so the samples gather around the obstacle surfaces
+  bool gaussianSamplingOnce(Eigen::Vector3d &sample)
+  {
+    const int max_tries = 20;
+    Eigen::Vector3d x1, x2;
+    for (int i = 0; i < max_tries; ++i)
+    {
+      regionSamplingOnce(x1);
+      x2 = x1 + obstacle_sigma_ * Eigen::Vector3d(normal_rand_(gen_), normal_rand_(gen_), normal_rand_(gen_));
+      bool v1 = occ_map_->isStateValid(x1), v2 = occ_map_->isStateValid(x2);
+      if (v1 != v2)
+      {
+        sample = v1 ? x1 : x2;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // uniform in the free space: a free voxel by rank, then a point inside it
+  void freeSamplingOnce(Eigen::Vector3d &sample)
+  {
+    int n = free_map_->freeVoxelNum();
+    int k = std::min((int)(uniform_rand_(gen_) * n), n - 1);
+    jitterInVoxel(free_map_->freeVoxelCorner(k), sample);
+  }
+
+  // uniform in the free space of the ellipsoid: free voxels are drawn from the (x, y) bounds of
+  // the ellipsoid and rejected if outside it
+  void freeInformedSamplingOnce(Eigen::Vector3d &sample)
+  {
+    const int max_tries = 100;
+    for (int i = 0; i < max_tries; ++i)
+    {
+      int k = std::min((int)(uniform_rand_(gen_) * free_ranges_len_.back()), free_ranges_len_.back() - 1);
+      int r = std::upper_bound(free_ranges_len_.begin(), free_ranges_len_.end(), k) - free_ranges_len_.begin() - 1;
+      jitterInVoxel(free_map_->freeVoxelCorner(free_ranges_[r].first + k - free_ranges_len_[r]), sample);
+      Eigen::Vector3d p = rotation_.transpose() * (sample - center_);
+      if ((p.array() / radii_.array()).matrix().squaredNorm() <= 1.0)
+        return;
+    }
+    // the free space inside the ellipsoid is tiny compared to its bounds
+    boundedInformedSamplingOnce(sample);
+  }
+
+  // uniform in the ellipsoid intersected with the map box, either by sampling the ellipsoid and
+  // rejecting outside the map, or by sampling the box bounding the intersection and rejecting
+  // outside the ellipsoid, whichever region is smaller, i.e. accepts more often
+  void boundedInformedSamplingOnce(Eigen::Vector3d &sample)
+  {
+    const int max_tries = 1000;
+    for (int i = 0; i < max_tries; ++i)
+    {
+      bool inside;
+      if (informed_from_box_)
+      {
+        unitCubeOnce(sample);
+        sample = informed_box_min_ + sample.cwiseProduct(informed_box_max_ - informed_box_min_);
+        Eigen::Vector3d p = rotation_.transpose() * (sample - center_);
+        inside = (p.array() / radii_.array()).matrix().squaredNorm() <= 1.0;
+      }
+      else
+      {
+        informedSamplingOnce(sample);
+        inside = (sample.array() >= origin_.array()).all() && (sample.array() <= (origin_ + range_).array()).all();
+      }
+      informed_tries_++;
+      if (inside)
+      {
+        informed_accepts_++;
+        return;
+      }
+    }
+    focalSegmentOnce(center_, rotation_, radii_, sample);
+  }
+
+  double informedRejectionRate() const
+  {
+    return informed_tries_ > 0 ? 1.0 - (double)informed_accepts_ / informed_tries_ : 0.0;
+  }
+
+  bool informedFromBox() const
+  {
+    return informed_from_box_;
+  }
+
+  void jitterInVoxel(const Eigen::Vector3d &corner, Eigen::Vector3d &sample)
+  {
+    double res = free_map_->getResolution();
+    sample[0] = corner[0] + res * uniform_rand_(gen_);
+    sample[1] = corner[1] + res * uniform_rand_(gen_);
+    sample[2] = corner[2] + res * uniform_rand_(gen_);
+  }
+
+  void unitCubeOnce(Eigen::Vector3d &u)
+  {
+    switch (sequence_type_)
+    {
+    case HALTON:
+      seq_idx_++;
+      u[0] = radicalInverse(seq_idx_, 2);
+      u[1] = radicalInverse(seq_idx_, 3);
+      u[2] = radicalInverse(seq_idx_, 5);
+      break;
+    case SOBOL:
+    case SCRAMBLED_SOBOL:
+    {
+      // gray code order, one xor per dimension
+      int c = __builtin_ctzll(~seq_idx_);
+      seq_idx_++;
+      for (int d = 0; d < 3; ++d)
+      {
+        sobol_x_[d] ^= sobol_v_[d][std::min(c, 31)];
+        u[d] = (sobol_x_[d] ^ sobol_shift_[d]) * (1.0 / 4294967296.0);
+      }
+      break;
+    }
+    default:
+      if (batch_sampling_)
+      {
+        if (cube_pos_ == BATCH_SIZE)
+          refillCubeBatch();
+        u = cube_batch_.col(cube_pos_++);
+        break;
+      }
+      u[0] = uniform_rand_(gen_);
+      u[1] = uniform_rand_(gen_);
+      u[2] = uniform_rand_(gen_);
+    }
+  }
+
+  // a point uniformly distributed along the path plus gaussian noise, i.e. a tube around it
+  void pathSamplingOnce(Eigen::Vector3d &sample)
+  {
+    double l = uniform_rand_(gen_) * bias_path_len_.back();
+    int i = std::upper_bound(bias_path_len_.begin(), bias_path_len_.end(), l) - bias_path_len_.begin();
+    i = std::min(std::max(i, 1), (int)bias_path_.size() - 1);
+    double seg_len = bias_path_len_[i] - bias_path_len_[i - 1];
+    double t = seg_len > 0.0 ? (l - bias_path_len_[i - 1]) / seg_len : 0.0;
+    sample = bias_path_[i - 1] + t * (bias_path_[i] - bias_path_[i - 1]);
+    sample[0] += path_sigma_ * normal_rand_(gen_);
+    sample[1] += path_sigma_ * normal_rand_(gen_);
+    sample[2] += path_sigma_ * normal_rand_(gen_);
+  }
+
   void reset()
   {
     informed_ = false;
+    informed_union_.clear();
+    union_volume_.clear();
+    informed_from_box_ = false;
+    informed_tries_ = 0;
+    informed_accepts_ = 0;
+    goal_reached_ = false;
+    seq_idx_ = 0;
+    sobol_x_[0] = sobol_x_[1] = sobol_x_[2] = 0;
+    free_ranges_.clear();
+    free_ranges_len_.clear();
+    bias_path_.clear();
+    bias_path_len_.clear();
+  }
+
+  void setBias(double goal_bias, double path_bias, double path_sigma)
+  {
+    goal_bias_ = goal_bias;
+    path_bias_ = path_bias;
+    path_sigma_ = path_sigma;
+  }
+
+  // pseudo random points are generated in blocks by xoshiro256+ and consumed from a buffer
+  void setBatchSampling(bool batch)
+  {
+    batch_sampling_ = batch;
+    cube_pos_ = ball_pos_ = BATCH_SIZE;
+  }
+
+  // decorrelate a copy of this sampler, e.g. one per planning thread: the pseudo random
+  // streams are reseeded, halton restarts at a random index and sobol gets a new digital shift
+  void seed(uint64_t s)
+  {
+    gen_.seed(s);
+    xoshiro_.seed(gen_());
+    cube_pos_ = ball_pos_ = BATCH_SIZE;
+    if (sequence_type_ == HALTON)
+      seq_idx_ = gen_() >> 40;
+    else if (sequence_type_ != RANDOM)
+      for (int d = 0; d < 3; ++d)
+        sobol_shift_[d] = (uint32_t)gen_();
+  }
+
+  void setSequenceType(int type)
+  {
+    sequence_type_ = type;
+    for (int d = 0; d < 3; ++d)
+      sobol_shift_[d] = type == SCRAMBLED_SOBOL ? (uint32_t)gen_() : 0;
+  }
+
+  // mix bridge test and gaussian obstacle based samples into the uniform ones
+  void setObstacleSampling(const env::OccMap::Ptr &map, double bridge_ratio, double gaussian_ratio, double sigma)
+  {
+    if (bridge_ratio > 0.0 || gaussian_ratio > 0.0)
+      occ_map_ = map;
+    bridge_ratio_ = bridge_ratio;
+    gaussian_ratio_ = gaussian_ratio;
+    obstacle_sigma_ = sigma;
+  }
+
+  // sample from the free voxels of the map instead of the whole box
+  void setFreeSpaceMap(const env::OccMap::Ptr &map)
+  {
+    free_map_ = map;
+  }
+
+  void setGoal(const Eigen::Vector3d &goal)
+  {
+    goal_ = goal;
+    goal_reached_ = false;
+  }
+
+  // a goal sample would only steer onto the node already at the goal and duplicate it
+  void setGoalReached()
+  {
+    goal_reached_ = true;
+  }
+
+  // the current best path, path biased sampling starts once it is set
+  void setBiasPath(const std::vector<Eigen::Vector3d> &path)
+  {
+    if (path_bias_ <= 0.0 || path.size() < 2)
+      return;
+    bias_path_ = path;
+    bias_path_len_.resize(path.size());
+    bias_path_len_[0] = 0.0;
+    for (size_t i = 1; i < path.size(); ++i)
+      bias_path_len_[i] = bias_path_len_[i - 1] + (path[i] - path[i - 1]).norm();
+    if (bias_path_len_.back() <= 0.0)
+    {
+      bias_path_.clear();
+      bias_path_len_.clear();
+    }
   }
 
   void setInformedTransRot(const Eigen::Vector3d &trans, const Eigen::Matrix3d &rot)
@@ -98,6 +544,35 @@ public:
   {
     informed_ = true;
     radii_ = scale;
+
+    // axis aligned bounds of the rotated ellipsoid, clipped by the map
+    Eigen::Vector3d half = (rotation_ * radii_.asDiagonal()).rowwise().norm();
+    informed_box_min_ = (center_ - half).cwiseMax(origin_);
+    informed_box_max_ = (center_ + half).cwiseMin(origin_ + range_);
+    double box_volume = (informed_box_max_ - informed_box_min_).cwiseMax(0.0).prod();
+    double ellipsoid_volume = 4.0 / 3.0 * M_PI * radii_.prod();
+    informed_from_box_ = box_volume < ellipsoid_volume;
+
+    if (free_map_ && free_map_->freeVoxelNum() > 0)
+    {
+      free_map_->freeVoxelRanges(center_ - half, center_ + half, free_ranges_);
+      free_ranges_len_.resize(free_ranges_.size() + 1);
+      free_ranges_len_[0] = 0;
+      for (size_t i = 0; i < free_ranges_.size(); ++i)
+        free_ranges_len_[i + 1] = free_ranges_len_[i] + free_ranges_[i].second - free_ranges_[i].first;
+      if (free_ranges_.empty())
+        free_ranges_len_.clear();
+    }
+  }
+
+  // informed sampling in the union of several ellipsoids, e.g. one per goal of a multi-goal query,
+  // it takes over from the single informed set until reset()
+  void setInformedUnion(const std::vector<InformedSet> &sets)
+  {
+    informed_union_ = sets;
+    union_volume_.assign(1, 0.0);
+    for (const InformedSet &set : sets)
+      union_volume_.push_back(union_volume_.back() + 4.0 / 3.0 * M_PI * set.radii.prod());
   }
 
   // (0.0 - 1.0)
@@ -107,16 +582,113 @@ public:
   }
 
 private:
+  static double radicalInverse(uint64_t i, int base)
+  {
+    double f = 1.0, r = 0.0;
+    while (i > 0)
+    {
+      f /= base;
+      r += f * (i % base);
+      i /= base;
+    }
+    return r;
+  }
+
+  // direction numbers of the first three sobol dimensions, primitive polynomials 1, x + 1, x^2 + x + 1
+  void initSobol()
+  {
+    for (int k = 0; k < 32; ++k)
+      sobol_v_[0][k] = 1u << (31 - k);
+    sobol_v_[1][0] = 1u << 31;
+    for (int k = 1; k < 32; ++k)
+      sobol_v_[1][k] = sobol_v_[1][k - 1] ^ (sobol_v_[1][k - 1] >> 1);
+    sobol_v_[2][0] = 1u << 31;
+    sobol_v_[2][1] = 3u << 30;
+    for (int k = 2; k < 32; ++k)
+      sobol_v_[2][k] = sobol_v_[2][k - 1] ^ sobol_v_[2][k - 2] ^ (sobol_v_[2][k - 2] >> 2);
+    sobol_x_[0] = sobol_x_[1] = sobol_x_[2] = 0;
+    sobol_shift_[0] = sobol_shift_[1] = sobol_shift_[2] = 0;
+  }
+
+  void refillCubeBatch()
+  {
+    double *u = cube_batch_.data();
+    for (int i = 0; i < 3 * BATCH_SIZE; ++i)
+      u[i] = xoshiro_.nextDouble();
+    cube_pos_ = 0;
+  }
+
+  // points of the cube [-1, 1]^3 that fall in the unit ball are uniform in the ball, about 52% do.
+  // cheaper than normal directions plus u^(1/3) radii, which need a log, sin, cos and cbrt per point
+  void refillBallBatch()
+  {
+    const int tries = 64;
+    Eigen::Array<double, 3, tries> cube;
+    Eigen::Array<double, 1, tries> sq_norm;
+    int n = 0;
+    while (n < BATCH_SIZE)
+    {
+      double *u = cube.data();
+      for (int i = 0; i < 3 * tries; ++i)
+        u[i] = 2.0 * xoshiro_.nextDouble() - 1.0;
+      sq_norm = cube.square().colwise().sum();
+      // branchless compaction, the accepted points overwrite the rejected ones
+      for (int i = 0; i < tries && n < BATCH_SIZE; ++i)
+      {
+        ball_batch_.col(n) = cube.col(i).matrix();
+        n += sq_norm[i] <= 1.0;
+      }
+    }
+    ball_pos_ = 0;
+  }
+
   Eigen::Vector3d range_, origin_;
   std::mt19937_64 gen_; // 用来产生随机数
   std::uniform_real_distribution<double> uniform_rand_;
   std::normal_distribution<double> normal_rand_;
 
+  // goal and path bias
+  double goal_bias_, path_bias_, path_sigma_;
+  Eigen::Vector3d goal_;
+  bool goal_reached_;
+  std::vector<Eigen::Vector3d> bias_path_;
+  std::vector<double> bias_path_len_; // cumulative length along bias_path_
+
+  // batched pseudo random points, one point per column
+  static const int BATCH_SIZE = 256;
+  bool batch_sampling_;
+  Xoshiro256p xoshiro_;
+  Eigen::Matrix3Xd cube_batch_, ball_batch_;
+  int cube_pos_, ball_pos_;
+
+  // low discrepancy sequences, scrambling is a random digital shift
+  int sequence_type_;
+  uint64_t seq_idx_;
+  uint32_t sobol_v_[3][32], sobol_x_[3], sobol_shift_[3];
+
+  // narrow passage sampling
+  env::OccMap::Ptr occ_map_;
+  double bridge_ratio_, gaussian_ratio_, obstacle_sigma_;
+
+  // free space sampling, free_ranges_len_ is the cumulative size of free_ranges_
+  env::OccMap::Ptr free_map_;
+  std::vector<std::pair<int, int>> free_ranges_;
+  std::vector<int> free_ranges_len_;
+
+  // bounded informed sampling
+  bool informed_from_box_;
+  Eigen::Vector3d informed_box_min_, informed_box_max_;
+  long informed_tries_, informed_accepts_;
+
   //for informed sampling
   bool informed_;
   Eigen::Vector3d center_, radii_;
   Eigen::Matrix3d rotation_;
 
+  // union informed sampling, union_volume_ is the cumulative volume of informed_union_
+  std::vector<InformedSet> informed_union_;
+  std::vector<double> union_volume_;
+
 };
 
 #endif
@@ -0,0 +1,73 @@
+/*
+Copyright (C) 2022 Hongkai Ye (kyle_yeh@163.com)
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+namespace path_plan
+{
+  // bounded lock-free queue for exactly one producer thread and one consumer thread.
+  // head_ is only written by the consumer and tail_ only by the producer, each on its own
+  // cache line; the release store of an index publishes the slot it passed over.
+  template <typename T>
+  class SPSCQueue
+  {
+  public:
+    explicit SPSCQueue(std::size_t capacity) : buffer_(capacity + 1), head_(0), tail_(0){};
+
+    // the item is only moved from when there is room for it
+    bool push(T &&item)
+    {
+      std::size_t tail = tail_.load(std::memory_order_relaxed);
+      std::size_t next = tail + 1 == buffer_.size() ? 0 : tail + 1;
+      if (next == head_.load(std::memory_order_acquire))
+        return false;
+      buffer_[tail] = std::move(item);
+      tail_.store(next, std::memory_order_release);
+      return true;
+    }
+
+    bool pop(T &item)
+    {
+      std::size_t head = head_.load(std::memory_order_relaxed);
+      if (head == tail_.load(std::memory_order_acquire))
+        return false;
+      item = std::move(buffer_[head]);
+      head_.store(head + 1 == buffer_.size() ? 0 : head + 1, std::memory_order_release);
+      return true;
+    }
+
+  private:
+    std::vector<T> buffer_; // one slot stays empty to tell a full queue from an empty one
+    char pad0_[64];
+    std::atomic<std::size_t> head_;
+    char pad1_[64];
+    std::atomic<std::size_t> tail_;
+    char pad2_[64];
+  };
+
+} // namespace path_plan
+
+#endif
@@ -0,0 +1,119 @@
+/*
+Copyright (C) 2022 Hongkai Ye (kyle_yeh@163.com)
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace path_plan
+{
+  // persistent worker threads for short data-parallel loops. The calling thread takes part in
+  // every loop, the indices are handed out one at a time from a shared counter, so a thread
+  // stuck on an expensive item leaves the remaining ones to the others.
+  class ThreadPool
+  {
+  public:
+    explicit ThreadPool(int thread_num) : stop_(false), generation_(0), task_(nullptr), task_size_(0), next_(0), active_(0)
+    {
+      for (int t = 1; t < thread_num; ++t)
+        workers_.emplace_back(&ThreadPool::workerLoop, this, t);
+    }
+    ~ThreadPool()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      wake_.notify_all();
+      for (std::thread &worker : workers_)
+        worker.join();
+    }
+
+    int threadNum() const
+    {
+      return workers_.size() + 1;
+    }
+
+    // f(i, thread) for every i in [0, n), returns when all are done. thread is in [0, threadNum()),
+    // 0 is the calling thread, so per-thread results can be kept without locking
+    void parallelFor(int n, const std::function<void(int, int)> &f)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &f;
+        task_size_ = n;
+        next_ = 0;
+        active_ = workers_.size();
+        generation_++;
+      }
+      wake_.notify_all();
+      runTask(0);
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [this] { return active_ == 0; });
+    }
+
+  private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_, done_;
+    bool stop_;
+    unsigned long generation_; // one per parallelFor, every worker joins each of them
+    const std::function<void(int, int)> *task_;
+    int task_size_;
+    std::atomic<int> next_;
+    int active_; // workers still running the current loop
+
+    void runTask(int thread)
+    {
+      for (int i = next_++; i < task_size_; i = next_++)
+        (*task_)(i, thread);
+    }
+
+    void workerLoop(int thread)
+    {
+      unsigned long seen = 0;
+      while (true)
+      {
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+          if (stop_)
+            return;
+          seen = generation_;
+        }
+        runTask(thread);
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          active_--;
+        }
+        done_.notify_one();
+      }
+    }
+  };
+
+} // namespace path_plan
+
+#endif
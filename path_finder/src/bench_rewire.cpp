@@ -0,0 +1,73 @@
+/*
+Copyright (C) 2022 Hongkai Ye (kyle_yeh@163.com)
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+// benchmark of the eager and the lazy cost propagation of RRTStar: the same queries, with the
+// same seed, are solved once per mode until the tree holds max_tree_node_nums nodes, so both
+// modes grow the same tree. Run with: roslaunch path_finder bench_rewire.launch
+#include "path_finder/bench_queries.h"
+#include "path_finder/rrt_star.h"
+
+#include <ros/ros.h>
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "bench_rewire");
+  ros::NodeHandle nh("~");
+
+  int query_num, seed;
+  nh.param("query_num", query_num, 20);
+  nh.param("seed", seed, 0);
+
+  env::OccMap::Ptr map(new env::OccMap);
+  map->init(nh);
+  path_plan::waitForMap(nh, map);
+  vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> queries = path_plan::benchQueries(map, query_num, seed);
+
+  double total_time[2] = {0.0, 0.0}, rewire_time[2] = {0.0, 0.0};
+  long cost_updates[2] = {0, 0};
+  int cost_mismatch = 0;
+  for (const auto &query : queries)
+  {
+    double cost[2] = {DBL_MAX, DBL_MAX};
+    for (int lazy = 0; lazy < 2; ++lazy)
+    {
+      nh.setParam("RRT_Star/lazy_cost_propagation", lazy == 1);
+      path_plan::RRTStar rrt_star(nh, map);
+      rrt_star.seed(seed);
+      ros::WallTime t0 = ros::WallTime::now();
+      if (rrt_star.plan(query.first, query.second))
+        cost[lazy] = rrt_star.getSolutions().back().first;
+      total_time[lazy] += (ros::WallTime::now() - t0).toSec();
+      rewire_time[lazy] += rrt_star.getRewireTime();
+      cost_updates[lazy] += rrt_star.getCostUpdates();
+    }
+    // both modes keep the costs exact, so they take the same decisions
+    cost_mismatch += cost[0] != cost[1];
+  }
+
+  const char *mode_name[2] = {"eager", "lazy "};
+  ROS_INFO_STREAM("[bench] " << queries.size() << " queries, search stops when the tree is full");
+  for (int lazy = 0; lazy < 2; ++lazy)
+    ROS_INFO_STREAM("[bench] " << mode_name[lazy] << ": " << 1e3 * total_time[lazy] / queries.size() << " ms/query, rewire share "
+                    << 100.0 * rewire_time[lazy] / total_time[lazy] << "%, " << cost_updates[lazy] / (long)queries.size()
+                    << " cost updates/query");
+  ROS_INFO_STREAM("[bench] final cost mismatches: " << cost_mismatch);
+  return 0;
+}
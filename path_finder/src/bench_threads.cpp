@@ -0,0 +1,76 @@
+/*
+Copyright (C) 2022 Hongkai Ye (kyle_yeh@163.com)
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+OF SUCH DAMAGE.
+*/
+// scaling of the parallel RRTStar with the number of threads: the same queries are solved with
+// 1, 2, 4, ... up to max_thread_num threads until the tree holds max_tree_node_nums nodes, the
+// throughput is the number of nodes inserted per second. The planner also logs the share of the
+// cpu time spent under the exclusive lock of each query.
+// Run with: roslaunch path_finder bench_threads.launch
+#include "path_finder/bench_queries.h"
+#include "path_finder/rrt_star.h"
+
+#include <ros/ros.h>
+#include <thread>
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "bench_threads");
+  ros::NodeHandle nh("~");
+
+  int query_num, seed, max_thread_num, max_tree_node_nums;
+  nh.param("query_num", query_num, 20);
+  nh.param("seed", seed, 0);
+  nh.param("max_thread_num", max_thread_num, 8);
+  nh.param("RRT_Star/max_tree_node_nums", max_tree_node_nums, 20000);
+
+  env::OccMap::Ptr map(new env::OccMap);
+  map->init(nh);
+  path_plan::waitForMap(nh, map);
+  vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> queries = path_plan::benchQueries(map, query_num, seed);
+
+  ROS_INFO_STREAM("[bench] " << queries.size() << " queries, search stops when the tree is full, "
+                             << std::thread::hardware_concurrency() << " hardware threads");
+  double single_thread_rate = 0.0;
+  for (int thread_num = 1; thread_num <= max_thread_num; thread_num *= 2)
+  {
+    nh.setParam("RRT_Star/thread_num", thread_num);
+    double total_time = 0.0, cost_sum = 0.0;
+    int solved = 0;
+    for (const auto &query : queries)
+    {
+      path_plan::RRTStar rrt_star(nh, map);
+      rrt_star.seed(seed);
+      ros::WallTime t0 = ros::WallTime::now();
+      if (rrt_star.plan(query.first, query.second))
+      {
+        cost_sum += rrt_star.getSolutions().back().first;
+        solved++;
+      }
+      total_time += (ros::WallTime::now() - t0).toSec();
+    }
+    double rate = max_tree_node_nums * queries.size() / total_time;
+    if (thread_num == 1)
+      single_thread_rate = rate;
+    ROS_INFO_STREAM("[bench] " << thread_num << " threads: " << 1e3 * total_time / queries.size() << " ms/query, "
+                               << rate << " nodes/s, speed-up " << rate / single_thread_rate << ", solved " << solved
+                               << ", mean cost " << (solved > 0 ? cost_sum / solved : 0.0));
+  }
+  return 0;
+}
@@ -21,10 +21,19 @@ OF SUCH DAMAGE.
 #include "self_msgs_and_srvs/GlbObsRcv.h"
 #include "occ_grid/occ_map.h"
 #include "path_finder/rrt_star.h"
+#include "path_finder/bi_rrt_star.h"
+#include "path_finder/bit_star.h"
+#include "path_finder/fmt_star.h"
+#include "path_finder/portfolio_planner.h"
 #include "visualization/visualization.hpp"
 
 #include <ros/ros.h>
 #include <geometry_msgs/PoseStamped.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
 
 class TesterPathFinder
 {
@@ -37,12 +46,26 @@ private:
     env::OccMap::Ptr env_ptr_;
     std::shared_ptr<visualization::Visualization> vis_ptr_;
     std::shared_ptr<path_plan::RRTStar> rrt_star_ptr_;
-
-
-    Eigen::Vector3d start_, goal_;
+    std::shared_ptr<path_plan::BiRRTStar> bi_rrt_star_ptr_;
+    std::shared_ptr<path_plan::BITStar> bit_star_ptr_;
+    std::shared_ptr<path_plan::FMTStar> fmt_star_ptr_;
+    std::shared_ptr<path_plan::ParallelPortfolioPlanner> portfolio_ptr_;
+    std::string planner_type_; // rrt_star, bi_rrt_star, bit_star, fmt_star or portfolio
+
+    // the planner runs on planning_thread_ so the callbacks never wait for a search: a new goal
+    // replaces the pending one and cancels the search in progress through cancel_
+    std::thread planning_thread_;
+    std::mutex goal_mtx_;
+    std::condition_variable goal_cv_;
+    bool has_goal_, shutdown_;
+    Eigen::Vector3d pending_goal_;
+    std::chrono::steady_clock::time_point pending_goal_time_;
+    std::atomic<bool> cancel_;
+
+    Eigen::Vector3d start_, goal_; // owned by planning_thread_
 
 public:
-    TesterPathFinder(const ros::NodeHandle &nh) : nh_(nh)
+    TesterPathFinder(const ros::NodeHandle &nh) : nh_(nh), has_goal_(false), shutdown_(false), cancel_(false)
     {
         env_ptr_.reset(new env::OccMap);
         env_ptr_->init(nh_);
@@ -50,8 +73,38 @@ public:
         vis_ptr_ = std::make_shared<visualization::Visualization>(nh_);
 
         //the reset here is not the reset of RRTStar
-        rrt_star_ptr_.reset(new path_plan::RRTStar(nh_, env_ptr_));
-        rrt_star_ptr_->setVisualizer(vis_ptr_);
+        nh_.param("planner_type", planner_type_, std::string("rrt_star"));
+        ROS_WARN_STREAM("[Tester] param: planner_type: " << planner_type_);
+        if (planner_type_ == "bi_rrt_star")
+        {
+            bi_rrt_star_ptr_.reset(new path_plan::BiRRTStar(nh_, env_ptr_));
+            bi_rrt_star_ptr_->setVisualizer(vis_ptr_);
+            bi_rrt_star_ptr_->setCancelToken(&cancel_);
+        }
+        else if (planner_type_ == "bit_star")
+        {
+            bit_star_ptr_.reset(new path_plan::BITStar(nh_, env_ptr_));
+            bit_star_ptr_->setVisualizer(vis_ptr_);
+            bit_star_ptr_->setCancelToken(&cancel_);
+        }
+        else if (planner_type_ == "fmt_star")
+        {
+            fmt_star_ptr_.reset(new path_plan::FMTStar(nh_, env_ptr_));
+            fmt_star_ptr_->setVisualizer(vis_ptr_);
+            fmt_star_ptr_->setCancelToken(&cancel_);
+        }
+        else if (planner_type_ == "portfolio")
+        {
+            portfolio_ptr_.reset(new path_plan::ParallelPortfolioPlanner(nh_, env_ptr_));
+            portfolio_ptr_->setVisualizer(vis_ptr_);
+            portfolio_ptr_->setCancelToken(&cancel_);
+        }
+        else
+        {
+            rrt_star_ptr_.reset(new path_plan::RRTStar(nh_, env_ptr_));
+            rrt_star_ptr_->setVisualizer(vis_ptr_);
+            rrt_star_ptr_->setCancelToken(&cancel_);
+        }
 
         goal_sub_ = nh_.subscribe("/goal", 1, &TesterPathFinder::goalCallback, this);
         execution_timer_ = nh_.createTimer(ros::Duration(1), &TesterPathFinder::executionCallback, this);
@@ -59,41 +112,109 @@ public:
 
         // 一开始起点设置为[0, 0, 0]
         start_.setZero();
+        planning_thread_ = std::thread(&TesterPathFinder::planningLoop, this);
     }
-    ~TesterPathFinder(){};
+    ~TesterPathFinder()
+    {
+        {
+            std::lock_guard<std::mutex> lck(goal_mtx_);
+            shutdown_ = true;
+            cancel_ = true;
+        }
+        goal_cv_.notify_one();
+        planning_thread_.join();
+    };
 
     void goalCallback(const geometry_msgs::PoseStamped::ConstPtr &goal_msg)
     {
+        Eigen::Vector3d goal(goal_msg->pose.position.x, goal_msg->pose.position.y, goal_msg->pose.position.z);
+        ROS_INFO_STREAM("\n-----------------------------\ngoal rcved at " << goal.transpose());
+        {
+            std::lock_guard<std::mutex> lck(goal_mtx_);
+            pending_goal_ = goal;
+            pending_goal_time_ = std::chrono::steady_clock::now();
+            has_goal_ = true;
+            cancel_ = true; // the search in progress, if any, is for an outdated goal
+        }
+        goal_cv_.notify_one();
+    }
 
-        goal_[0] = goal_msg->pose.position.x;
-        goal_[1] = goal_msg->pose.position.y;
-        goal_[2] = goal_msg->pose.position.z;
-        ROS_INFO_STREAM("\n-----------------------------\ngoal rcved at " << goal_.transpose());
-        vis_ptr_->visualize_a_ball(start_, 0.3, "start", visualization::Color::pink);
-        vis_ptr_->visualize_a_ball(goal_, 0.3, "goal", visualization::Color::steelblue);
+    // takes the latest goal, plans to it from the last goal reached and delivers the result
+    void planningLoop()
+    {
+        while (true)
+        {
+            std::chrono::steady_clock::time_point goal_time;
+            {
+                std::unique_lock<std::mutex> lck(goal_mtx_);
+                goal_cv_.wait(lck, [this] { return has_goal_ || shutdown_; });
+                if (shutdown_)
+                    return;
+                goal_ = pending_goal_;
+                goal_time = pending_goal_time_;
+                has_goal_ = false;
+                cancel_ = false;
+            }
+            double wait_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - goal_time).count();
+            vis_ptr_->visualize_a_ball(start_, 0.3, "start", visualization::Color::pink);
+            vis_ptr_->visualize_a_ball(goal_, 0.3, "goal", visualization::Color::steelblue);
+
+            bool res;
+            if (planner_type_ == "bi_rrt_star")
+                res = runPlanner(*bi_rrt_star_ptr_, "[BiRRT*]", wait_time);
+            else if (planner_type_ == "bit_star")
+                res = runPlanner(*bit_star_ptr_, "[BIT*]", wait_time);
+            else if (planner_type_ == "fmt_star")
+                res = runPlanner(*fmt_star_ptr_, "[FMT*]", wait_time);
+            else if (planner_type_ == "portfolio")
+                res = runPlanner(*portfolio_ptr_, "[Portfolio]", wait_time);
+            else
+                res = runPlanner(*rrt_star_ptr_, "[RRT*]", wait_time);
+            if (res)
+                start_ = goal_;
+        }
+    }
 
-        bool rrt_star_res = rrt_star_ptr_->plan(start_, goal_);
-        if (rrt_star_res)
+    // the planners share their interface, not a base class. A preempted search delivers nothing
+    // and the start stays where it was.
+    template <typename PlannerT>
+    bool runPlanner(PlannerT &planner, const std::string &name, double wait_time)
+    {
+        bool res = planner.plan(start_, goal_);
+        if (cancel_)
+        {
+            ROS_WARN_STREAM(name << " goal " << goal_.transpose() << " preempted by a newer goal");
+            return false;
+        }
+        if (res)
         {
             //display all the path gotten during in the exploration in blue line
-            vector<vector<Eigen::Vector3d>> routes = rrt_star_ptr_->getAllPaths();
+            vector<vector<Eigen::Vector3d>> routes = planner.getAllPaths();
             ROS_INFO_STREAM("We have get " <<  routes.size() << " paths totally");
             vis_ptr_->visualize_path_list(routes, "rrt_star_paths", visualization::blue);
 
             //display the best path 
-            vector<Eigen::Vector3d> final_path = rrt_star_ptr_->getPath();
+            vector<Eigen::Vector3d> final_path = planner.getPath();
             vis_ptr_->visualize_path(final_path, "rrt_star_final_path");  // display in nay_msgs/Path
             vis_ptr_->visualize_pointcloud(final_path, "rrt_star_final_wpts"); // display in pointcloud
             
             // print the optimal solution
-            vector<std::pair<double, double>> slns = rrt_star_ptr_->getSolutions();
-            ROS_INFO_STREAM("[RRT*] final path len is " << slns.back().first << " and the final time is " << slns.back().second);
-            start_ = goal_;
+            vector<std::pair<double, double>> slns = planner.getSolutions();
+            ROS_INFO_STREAM(name << " final path len is " << slns.back().first << " and the final time is " << slns.back().second);
+            ROS_INFO_STREAM(name << " goal to first path: " << wait_time + slns.front().second << " s, "
+                            << wait_time << " s of it before the search started");
+            // cost against iteration, for comparing the sampling sequences
+            vector<int> iters = planner.getSolutionIterations();
+            std::stringstream ss;
+            for (size_t i = 0; i < slns.size(); ++i)
+                ss << " (" << iters[i] << ", " << slns[i].first << ")";
+            ROS_INFO_STREAM(name << " (iteration, cost):" << ss.str());
             /* for(auto x:slns)
             {
                 ROS_INFO_STREAM("The length of this path is: " << x.first << " the total time: " << x.second);
             } */
         }
+        return res;
     }
 
     void executionCallback(const ros::TimerEvent &event)